@@ -3,12 +3,14 @@
 #include <iostream>
 #include <string_view>
 #include <optional>
+#include <sstream>
 #include <vector>
 #include "protocol/uci_command.h"
 #include "protocol/ucci_command.h"
 #include "protocol/option.h"
 #include "core/engine.h"
 #include "utils/osyncstream.h"
+#include "utils/trace.h"
 
 namespace Carp
 {
@@ -99,49 +101,73 @@ std::string Command::AnalyzeCommand(std::span<std::string_view> command)
 }
 
 Controller::Controller() :
+	m_out(std::cout),
 	m_engine(std::make_unique<Engine>()),
 	m_option_container(std::make_unique<OptionContainer>())
 {
 	m_engine->InitOptions(*m_option_container);
 }
 
+Controller::Controller(std::ostream& os, const SharedResources& shared) :
+	m_out(os),
+	m_engine(std::make_unique<Engine>(os, shared)),
+	m_option_container(std::make_unique<OptionContainer>())
+{
+	m_engine->InitOptions(*m_option_container);
+}
+
 Controller::~Controller() = default;
 
 void Controller::Loop()
+{
+	Loop(std::cin);
+}
+
+void Controller::Loop(std::istream& is)
 {
 	std::string cmd_str;
+	CARP_TRACE_THREAD_NAME("protocol");
 
 	// 先把引擎名和作者打出来
-	std::cout << Engine::GetEngineName() << " by " << Engine::GetAuthorName() << std::endl;
-	while (std::getline(std::cin, cmd_str))
+	OSyncStream{ m_out } << Engine::GetEngineName() << " by " << Engine::GetAuthorName() << std::endl;
+	while (std::getline(is, cmd_str))
 	{
 		std::string_view cmd = Trim(cmd_str);
 		// 先检查是不是退出命令
 		if (cmd == QUIT_COMMAND)
 			break;
-		// 再检查是不是修改协议的命令
-		auto protocol_type = CheckProtocol(cmd);
-		// 如果有协议类型就走切换协议的逻辑，否则就走解析命令的逻辑
-		if (protocol_type.has_value())
-		{
-			// 如果协议类型不同就切换新的协议
-			if (m_command == nullptr || !m_command->IsSameType(*protocol_type))
-				m_command = std::make_unique<Command>(*protocol_type, *m_engine, *m_option_container);
-			OSyncStream{ std::cout } << *m_command << std::endl;
-		}
-		else
-		{
-			// 如果没指定协议就忽略
-			if (m_command == nullptr)
-				continue;
-			auto split_cmd = Split(cmd);
-			if (split_cmd.empty())
-				continue;
-			auto result = m_command->AnalyzeCommand(split_cmd);
-			if (!result.empty())
-				OSyncStream{ std::cout } << result << std::endl;
-		}
+		CARP_TRACE_SCOPE("protocol", "command", 0, cmd);
+		auto result = HandleCommand(cmd);
+		if (!result.empty())
+			OSyncStream{ m_out } << result << std::endl;
+	}
+	// 输入结束时可能还在搜索，停下来再返回
+	m_engine->Stop();
+}
+
+std::string Controller::HandleCommand(std::string_view cmd)
+{
+	cmd = Trim(cmd);
+	// 先检查是不是修改协议的命令
+	auto protocol_type = CheckProtocol(cmd);
+	// 如果有协议类型就走切换协议的逻辑，否则就走解析命令的逻辑
+	if (protocol_type.has_value())
+	{
+		// 如果协议类型不同就切换新的协议
+		if (m_command == nullptr || !m_command->IsSameType(*protocol_type))
+			m_command = std::make_unique<Command>(*protocol_type, *m_engine, *m_option_container);
+		std::ostringstream os;
+		os << *m_command;
+		return os.str();
 	}
+
+	// 如果没指定协议就忽略
+	if (m_command == nullptr)
+		return "";
+	auto split_cmd = Split(cmd);
+	if (split_cmd.empty())
+		return "";
+	return m_command->AnalyzeCommand(split_cmd);
 }
 
 std::ostream& operator<<(std::ostream& os, const Command& command)
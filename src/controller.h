@@ -1,17 +1,23 @@
 #pragma once
 
+#include <iosfwd>
 #include <memory>
+#include <string>
+#include <string_view>
 
 namespace Carp
 {
 class Engine;
 class Command;
 class OptionContainer;
+struct SharedResources;
 
 class Controller
 {
 public:
 	Controller();
+	// 服务器的一个会话，命令的回复和搜索输出都写到os
+	Controller(std::ostream& os, const SharedResources& shared);
 	~Controller();
 	Controller(const Controller&) = delete;
 	Controller(Controller&&) = delete;
@@ -19,8 +25,13 @@ public:
 	Controller& operator=(Controller&&) = delete;
 
 	void Loop();
+	// 从is读取命令直到quit或者输入结束
+	void Loop(std::istream& is);
+	// 处理一行命令（不包括quit），返回需要输出的内容，没有输出时返回空串
+	std::string HandleCommand(std::string_view cmd);
 
 private:
+	std::ostream& m_out;
 	const std::unique_ptr<Engine> m_engine;
 	std::unique_ptr<Command> m_command;
 	std::unique_ptr<OptionContainer> m_option_container;
@@ -0,0 +1,309 @@
+#include "attack.h"
+#include "utils/cpu.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define CARP_PEXT_SLIDERS 1
+#endif
+
+namespace Carp
+{
+
+namespace detail
+{
+
+constexpr std::array<std::pair<int, int>, DIRECTION_NB> DIRECTIONS = { {
+	{ 0, 1 }, { 0, -1 }, { 1, 0 }, { -1, 0 },
+} };
+
+static constexpr bool IsOnBoard(int file, int rank) noexcept
+{
+	return file >= 0 && file < BOARD_FILE_NB && rank >= 0 && rank < BOARD_RANK_NB;
+}
+
+// 九宫，坐标可能在棋盘外面
+static constexpr bool IsInPalace(int file, int rank) noexcept
+{
+	return file >= 3 && file <= 5 && ((rank >= 0 && rank <= 2) || (rank >= 7 && rank < BOARD_RANK_NB));
+}
+
+// 是否在红方那半边
+static constexpr bool IsRedSide(int rank) noexcept
+{
+	return rank <= 4;
+}
+
+// 编译期生成，启动时不需要任何初始化
+static consteval AttackTables BuildAttackTables()
+{
+	AttackTables tables{};
+
+	for (int sq = 0; sq < SQUARE_NB; sq++)
+		tables.square_bb[sq] = Bitboard::FromSquare(static_cast<Square>(sq));
+
+	for (int sq = 0; sq < SQUARE_NB; sq++)
+	{
+		const int file = GetFile(static_cast<Square>(sq));
+		const int rank = GetRank(static_cast<Square>(sq));
+
+		// 马，先沿直线走一步（马腿），再斜着走一步
+		for (const auto& [df, dr] : DIRECTIONS)
+		{
+			const int leg_file = file + df;
+			const int leg_rank = rank + dr;
+			if (!IsOnBoard(leg_file, leg_rank))
+				continue;
+			for (int side : { -1, 1 })
+			{
+				const int to_file = leg_file + df + (dr != 0 ? side : 0);
+				const int to_rank = leg_rank + dr + (df != 0 ? side : 0);
+				if (!IsOnBoard(to_file, to_rank))
+					continue;
+				const auto to = MakeSquare(to_file, to_rank);
+				const auto leg = MakeSquare(leg_file, leg_rank);
+				auto& moves = tables.knight_moves[sq];
+				moves.targets[moves.count++] = LeapTarget{ to, leg };
+				auto& attackers = tables.knight_attackers[to];
+				attackers.targets[attackers.count++] = LeapTarget{ static_cast<Square>(sq), leg };
+			}
+		}
+
+		// 象，不能过河
+		for (int df : { -2, 2 })
+		{
+			for (int dr : { -2, 2 })
+			{
+				const int to_file = file + df;
+				const int to_rank = rank + dr;
+				if (!IsOnBoard(to_file, to_rank) || IsRedSide(to_rank) != IsRedSide(rank))
+					continue;
+				auto& moves = tables.elephant_moves[sq];
+				moves.targets[moves.count++] = LeapTarget{ MakeSquare(to_file, to_rank), MakeSquare(file + df / 2, rank + dr / 2) };
+			}
+		}
+
+		// 士和将帅，不能出九宫
+		if (IsInPalace(file, rank))
+		{
+			for (int df : { -1, 1 })
+			{
+				for (int dr : { -1, 1 })
+				{
+					if (IsInPalace(file + df, rank + dr) && IsRedSide(rank + dr) == IsRedSide(rank))
+						tables.advisor_moves[sq] |= MakeSquare(file + df, rank + dr);
+				}
+			}
+			for (const auto& [df, dr] : DIRECTIONS)
+			{
+				if (IsInPalace(file + df, rank + dr) && IsRedSide(rank + dr) == IsRedSide(rank))
+					tables.king_moves[sq] |= MakeSquare(file + df, rank + dr);
+			}
+		}
+
+		// 兵，过河之后才能横着走
+		for (auto player : { PlayerType::Red, PlayerType::Black })
+		{
+			const int forward = player == PlayerType::Red ? 1 : -1;
+			const bool crossed = (player == PlayerType::Red) != IsRedSide(rank);
+			auto& moves = tables.pawn_moves[PlayerIndex(player)][sq];
+			if (IsOnBoard(file, rank + forward))
+				moves |= MakeSquare(file, rank + forward);
+			if (crossed)
+			{
+				if (IsOnBoard(file - 1, rank))
+					moves |= MakeSquare(file - 1, rank);
+				if (IsOnBoard(file + 1, rank))
+					moves |= MakeSquare(file + 1, rank);
+			}
+		}
+
+		for (int dir = 0; dir < DIRECTION_NB; dir++)
+		{
+			const auto [df, dr] = DIRECTIONS[dir];
+			auto& ray = tables.rays[sq][dir];
+			for (int f = file + df, r = rank + dr; IsOnBoard(f, r); f += df, r += dr)
+				ray.squares[ray.count++] = MakeSquare(f, r);
+		}
+	}
+
+	for (int player = 0; player < PLAYER_NB; player++)
+	{
+		for (int from = 0; from < SQUARE_NB; from++)
+		{
+			for (Bitboard bb = tables.pawn_moves[player][from]; bb; )
+				tables.pawn_attackers[player][bb.PopLsb()] |= static_cast<Square>(from);
+		}
+	}
+
+	return tables;
+}
+
+constexpr AttackTables ATTACK_TABLES = BuildAttackTables();
+
+} // namespace detail
+
+namespace
+{
+
+Bitboard RookAttacksByRay(Square sq, Bitboard occupied) noexcept
+{
+	Bitboard attacks;
+	for (int dir = 0; dir < DIRECTION_NB; dir++)
+	{
+		for (Square to : GetRay(sq, dir))
+		{
+			attacks |= to;
+			if (occupied.Test(to))
+				break;
+		}
+	}
+	return attacks;
+}
+
+Bitboard CannonAttacksByRay(Square sq, Bitboard occupied) noexcept
+{
+	Bitboard attacks;
+	for (int dir = 0; dir < DIRECTION_NB; dir++)
+	{
+		bool screen = false;
+		for (Square to : GetRay(sq, dir))
+		{
+			if (!occupied.Test(to))
+				continue;
+			if (screen)
+			{
+				attacks |= to;
+				break;
+			}
+			screen = true;
+		}
+	}
+	return attacks;
+}
+
+#ifdef CARP_PEXT_SLIDERS
+// 车和炮的攻击拆成横竖两条线分别查表
+// 一行的9个格子在位棋盘里是连续的，直接移位取出来；一列的10个格子用PEXT收集起来
+struct SliderTables
+{
+	std::array<std::array<std::uint16_t, 1 << BOARD_FILE_NB>, BOARD_FILE_NB> rook_rank;
+	std::array<std::array<std::uint16_t, 1 << BOARD_FILE_NB>, BOARD_FILE_NB> cannon_rank;
+	std::array<std::array<std::uint16_t, 1 << BOARD_RANK_NB>, BOARD_RANK_NB> rook_file;
+	std::array<std::array<std::uint16_t, 1 << BOARD_RANK_NB>, BOARD_RANK_NB> cannon_file;
+	// 每一列在m_lo和m_hi里的格子
+	std::array<std::uint64_t, BOARD_FILE_NB> file_lo;
+	std::array<std::uint64_t, BOARD_FILE_NB> file_hi;
+	std::array<int, BOARD_FILE_NB> file_lo_count;
+};
+
+// 一条线上从pos出发的攻击，cannon为true时算炮的吃子
+constexpr std::uint16_t LineAttacks(int pos, unsigned occupied, int length, bool cannon) noexcept
+{
+	std::uint16_t attacks = 0;
+	for (int step : { -1, 1 })
+	{
+		bool screen = false;
+		for (int i = pos + step; i >= 0 && i < length; i += step)
+		{
+			const bool blocked = (occupied >> i) & 1;
+			if (!cannon)
+			{
+				attacks |= 1 << i;
+				if (blocked)
+					break;
+			}
+			else if (blocked)
+			{
+				if (screen)
+				{
+					attacks |= 1 << i;
+					break;
+				}
+				screen = true;
+			}
+		}
+	}
+	return attacks;
+}
+
+consteval SliderTables BuildSliderTables() noexcept
+{
+	SliderTables tables{};
+	for (int file = 0; file < BOARD_FILE_NB; file++)
+	{
+		for (unsigned occ = 0; occ < (1u << BOARD_FILE_NB); occ++)
+		{
+			tables.rook_rank[file][occ] = LineAttacks(file, occ, BOARD_FILE_NB, false);
+			tables.cannon_rank[file][occ] = LineAttacks(file, occ, BOARD_FILE_NB, true);
+		}
+		for (int rank = 0; rank < BOARD_RANK_NB; rank++)
+		{
+			const int sq = MakeSquare(file, rank);
+			if (sq < 64)
+				tables.file_lo[file] |= std::uint64_t{ 1 } << sq;
+			else
+				tables.file_hi[file] |= std::uint64_t{ 1 } << (sq - 64);
+		}
+		tables.file_lo_count[file] = std::popcount(tables.file_lo[file]);
+	}
+	for (int rank = 0; rank < BOARD_RANK_NB; rank++)
+	{
+		for (unsigned occ = 0; occ < (1u << BOARD_RANK_NB); occ++)
+		{
+			tables.rook_file[rank][occ] = LineAttacks(rank, occ, BOARD_RANK_NB, false);
+			tables.cannon_file[rank][occ] = LineAttacks(rank, occ, BOARD_RANK_NB, true);
+		}
+	}
+	return tables;
+}
+
+constexpr SliderTables SLIDER_TABLES = BuildSliderTables();
+// 只有PEXT是硬件实现的时候才用查表，否则还是走射线
+const bool USE_PEXT_SLIDERS = GetCpuFeatures().fast_pext;
+
+template <bool CANNON>
+__attribute__((target("bmi2"))) Bitboard SliderAttacksByPext(Square sq, Bitboard occupied) noexcept
+{
+	const int file = GetFile(sq);
+	const int rank = GetRank(sq);
+	const auto& rank_table = CANNON ? SLIDER_TABLES.cannon_rank : SLIDER_TABLES.rook_rank;
+	const auto& file_table = CANNON ? SLIDER_TABLES.cannon_file : SLIDER_TABLES.rook_file;
+
+	using u128 = unsigned __int128;
+	const u128 board = occupied.Low() | (static_cast<u128>(occupied.High()) << 64);
+	const int shift = rank * BOARD_FILE_NB;
+	const auto rank_occ = static_cast<unsigned>(board >> shift) & ((1u << BOARD_FILE_NB) - 1);
+	const u128 rank_attacks = static_cast<u128>(rank_table[file][rank_occ]) << shift;
+
+	const auto lo_mask = SLIDER_TABLES.file_lo[file];
+	const auto hi_mask = SLIDER_TABLES.file_hi[file];
+	const int lo_count = SLIDER_TABLES.file_lo_count[file];
+	const auto file_occ = _pext_u64(occupied.Low(), lo_mask) | (_pext_u64(occupied.High(), hi_mask) << lo_count);
+	const std::uint64_t file_attacks = file_table[rank][file_occ];
+
+	return Bitboard{ static_cast<std::uint64_t>(rank_attacks) | _pdep_u64(file_attacks, lo_mask),
+		static_cast<std::uint64_t>(rank_attacks >> 64) | _pdep_u64(file_attacks >> lo_count, hi_mask) };
+}
+#endif
+
+} // namespace
+
+Bitboard RookAttacks(Square sq, Bitboard occupied) noexcept
+{
+#ifdef CARP_PEXT_SLIDERS
+	if (USE_PEXT_SLIDERS)
+		return SliderAttacksByPext<false>(sq, occupied);
+#endif
+	return RookAttacksByRay(sq, occupied);
+}
+
+Bitboard CannonAttacks(Square sq, Bitboard occupied) noexcept
+{
+#ifdef CARP_PEXT_SLIDERS
+	if (USE_PEXT_SLIDERS)
+		return SliderAttacksByPext<true>(sq, occupied);
+#endif
+	return CannonAttacksByRay(sq, occupied);
+}
+
+} // namespace Carp
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "def.h"
+#include "bitboard.h"
+
+namespace Carp
+{
+
+// 马和象的走法，block是马腿或者象眼，有子就走不了
+struct LeapTarget
+{
+	Square to;
+	Square block;
+};
+
+template <std::size_t N>
+struct LeapTargets
+{
+	std::array<LeapTarget, N> targets{};
+	std::uint8_t count = 0;
+
+	const LeapTarget* begin() const noexcept { return targets.data(); }
+	const LeapTarget* end() const noexcept { return targets.data() + count; }
+};
+
+// 从某个格子往一个方向走到棋盘边缘经过的所有格子，按由近到远的顺序
+struct Ray
+{
+	std::array<Square, BOARD_RANK_NB - 1> squares{};
+	std::uint8_t count = 0;
+
+	const Square* begin() const noexcept { return squares.data(); }
+	const Square* end() const noexcept { return squares.data() + count; }
+};
+
+constexpr int DIRECTION_NB = 4;
+
+namespace detail
+{
+struct AttackTables
+{
+	std::array<Bitboard, SQUARE_NB> square_bb;
+	std::array<LeapTargets<8>, SQUARE_NB> knight_moves;
+	// 哪些格子上的马可以攻击到这个格子，block是对应的马腿
+	std::array<LeapTargets<8>, SQUARE_NB> knight_attackers;
+	std::array<LeapTargets<4>, SQUARE_NB> elephant_moves;
+	std::array<Bitboard, SQUARE_NB> advisor_moves;
+	std::array<Bitboard, SQUARE_NB> king_moves;
+	std::array<std::array<Bitboard, SQUARE_NB>, PLAYER_NB> pawn_moves;
+	// 哪些格子上的兵可以攻击到这个格子
+	std::array<std::array<Bitboard, SQUARE_NB>, PLAYER_NB> pawn_attackers;
+	std::array<std::array<Ray, DIRECTION_NB>, SQUARE_NB> rays;
+};
+
+extern const AttackTables ATTACK_TABLES;
+} // namespace detail
+
+inline Bitboard SquareBB(Square sq) noexcept { return detail::ATTACK_TABLES.square_bb[sq]; }
+inline const LeapTargets<8>& KnightMoves(Square sq) noexcept { return detail::ATTACK_TABLES.knight_moves[sq]; }
+inline const LeapTargets<8>& KnightAttackers(Square sq) noexcept { return detail::ATTACK_TABLES.knight_attackers[sq]; }
+inline const LeapTargets<4>& ElephantMoves(Square sq) noexcept { return detail::ATTACK_TABLES.elephant_moves[sq]; }
+inline Bitboard AdvisorMoves(Square sq) noexcept { return detail::ATTACK_TABLES.advisor_moves[sq]; }
+inline Bitboard KingMoves(Square sq) noexcept { return detail::ATTACK_TABLES.king_moves[sq]; }
+inline Bitboard PawnMoves(PlayerType player, Square sq) noexcept { return detail::ATTACK_TABLES.pawn_moves[PlayerIndex(player)][sq]; }
+inline Bitboard PawnAttackers(PlayerType player, Square sq) noexcept { return detail::ATTACK_TABLES.pawn_attackers[PlayerIndex(player)][sq]; }
+inline const Ray& GetRay(Square sq, int direction) noexcept { return detail::ATTACK_TABLES.rays[sq][direction]; }
+
+// 车的攻击范围，包括每个方向上碰到的第一个子
+Bitboard RookAttacks(Square sq, Bitboard occupied) noexcept;
+// 炮的吃子范围，每个方向上隔着一个炮架碰到的第一个子
+Bitboard CannonAttacks(Square sq, Bitboard occupied) noexcept;
+
+} // namespace Carp
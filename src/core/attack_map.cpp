@@ -0,0 +1,157 @@
+#include "attack_map.h"
+#include "attack.h"
+#include "position.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+struct NeighborTables
+{
+	// 所在的行和列
+	std::array<Bitboard, SQUARE_NB> lines;
+	// 上下左右相邻的格子，马在这里的话马腿就是中间的格子
+	std::array<Bitboard, SQUARE_NB> orthogonal;
+	// 斜着相邻的格子，象在这里的话象眼就是中间的格子
+	std::array<Bitboard, SQUARE_NB> diagonal;
+};
+
+consteval NeighborTables BuildNeighborTables() noexcept
+{
+	NeighborTables tables{};
+	for (int sq = 0; sq < SQUARE_NB; sq++)
+	{
+		const int file = GetFile(static_cast<Square>(sq));
+		const int rank = GetRank(static_cast<Square>(sq));
+		for (int other = 0; other < SQUARE_NB; other++)
+		{
+			const int df = GetFile(static_cast<Square>(other)) - file;
+			const int dr = GetRank(static_cast<Square>(other)) - rank;
+			if (other != sq && (df == 0 || dr == 0))
+				tables.lines[sq] |= static_cast<Square>(other);
+			if (df * df + dr * dr == 1)
+				tables.orthogonal[sq] |= static_cast<Square>(other);
+			if (df * df == 1 && dr * dr == 1)
+				tables.diagonal[sq] |= static_cast<Square>(other);
+		}
+	}
+	return tables;
+}
+
+constexpr NeighborTables NEIGHBORS = BuildNeighborTables();
+
+Bitboard PieceAttacks(const Position& pos, Square sq, Bitboard occupied) noexcept
+{
+	const auto [player, piece] = DeComposePlayerPiece(pos.PieceOn(sq));
+	Bitboard attacks;
+	switch (piece)
+	{
+	case PieceType::King:
+		// 照面也算攻击
+		attacks = KingMoves(sq) | (RookAttacks(sq, occupied) & pos.Pieces(Opponent(player), PieceType::King));
+		break;
+	case PieceType::Advisor:
+		attacks = AdvisorMoves(sq);
+		break;
+	case PieceType::Elephant:
+		for (const auto& target : ElephantMoves(sq))
+		{
+			if (!occupied.Test(target.block))
+				attacks |= target.to;
+		}
+		break;
+	case PieceType::Knight:
+		for (const auto& target : KnightMoves(sq))
+		{
+			if (!occupied.Test(target.block))
+				attacks |= target.to;
+		}
+		break;
+	case PieceType::Rook:
+		attacks = RookAttacks(sq, occupied);
+		break;
+	case PieceType::Cannon:
+	{
+		// 把炮架拿掉以后车能多走到的格子，就是炮架后面直到下一个子的范围
+		const auto rook_attacks = RookAttacks(sq, occupied);
+		attacks = RookAttacks(sq, occupied ^ (rook_attacks & occupied)) & ~rook_attacks;
+		break;
+	}
+	case PieceType::Pawn:
+		attacks = PawnMoves(player, sq);
+		break;
+	}
+	return attacks;
+}
+
+} // namespace
+
+void AttackMap::Init(const Position& pos) noexcept
+{
+	m_attacks.fill(Bitboard{});
+	for (Bitboard bb = pos.Occupied(); bb; )
+	{
+		const auto sq = bb.PopLsb();
+		m_attacks[sq] = PieceAttacks(pos, sq, pos.Occupied());
+	}
+	UpdateAttacked(pos);
+}
+
+void AttackMap::Update(const Position& pos, Move move) noexcept
+{
+	const auto from = move.From();
+	const auto to = move.To();
+	const auto occupied = pos.Occupied();
+
+	// 车、炮、将帅只要和这两个格子在同一行或列，攻击范围就可能变
+	const auto sliders = pos.Pieces(PlayerPieceType::RedRook) | pos.Pieces(PlayerPieceType::BlackRook)
+		| pos.Pieces(PlayerPieceType::RedCannon) | pos.Pieces(PlayerPieceType::BlackCannon)
+		| pos.Pieces(PlayerPieceType::RedKing) | pos.Pieces(PlayerPieceType::BlackKing);
+	Bitboard affected = sliders & (NEIGHBORS.lines[from] | NEIGHBORS.lines[to]);
+	const auto knights = pos.Pieces(PlayerPieceType::RedKnight) | pos.Pieces(PlayerPieceType::BlackKnight);
+	affected |= knights & (NEIGHBORS.orthogonal[from] | NEIGHBORS.orthogonal[to]);
+	const auto elephants = pos.Pieces(PlayerPieceType::RedElephant) | pos.Pieces(PlayerPieceType::BlackElephant);
+	affected |= elephants & (NEIGHBORS.diagonal[from] | NEIGHBORS.diagonal[to]);
+	affected |= SquareBB(from) | to;
+
+	while (affected)
+	{
+		const auto sq = affected.PopLsb();
+		m_attacks[sq] = occupied.Test(sq) ? PieceAttacks(pos, sq, occupied) : Bitboard{};
+	}
+	UpdateAttacked(pos);
+}
+
+int AttackMap::AttackCount(const Position& pos, PlayerType player, Square sq) const noexcept
+{
+	return AttackersTo(pos, sq, player).Count();
+}
+
+Bitboard AttackMap::AttackersTo(const Position& pos, Square sq, PlayerType player) const noexcept
+{
+	Bitboard attackers;
+	if (!IsAttacked(player, sq))
+		return attackers;
+	for (Bitboard bb = pos.Occupied(player); bb; )
+	{
+		const auto from = bb.PopLsb();
+		if (m_attacks[from].Test(sq))
+			attackers |= from;
+	}
+	return attackers;
+}
+
+void AttackMap::UpdateAttacked(const Position& pos) noexcept
+{
+	for (auto player : { PlayerType::Red, PlayerType::Black })
+	{
+		Bitboard attacked;
+		for (Bitboard bb = pos.Occupied(player); bb; )
+			attacked |= m_attacks[bb.PopLsb()];
+		m_attacked[PlayerIndex(player)] = attacked;
+	}
+}
+
+} // namespace Carp
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include "def.h"
+#include "bitboard.h"
+#include "move.h"
+
+namespace Carp
+{
+
+class Position;
+
+// 增量维护的攻击表：每个子的攻击范围，以及双方能攻击到的格子
+// 被攻击的次数不单独维护，按格子计数的版本更新时要逐个格子加减，实测比每次合并攻击范围还慢
+// 走子或者悔棋之后只重算受影响的子：起点和终点上的子，这两个格子所在行列上的车、炮、将帅，
+// 以及马腿、象眼落在这两个格子上的马和象
+// 将帅的攻击范围里包括照面的对方将帅；炮的攻击范围是炮架后面直到下一个子的所有格子（空格子上要是有子也能吃）
+class AttackMap
+{
+public:
+	void Init(const Position& pos) noexcept;
+	// 走子和悔棋之后都调用这个，pos是已经变化后的局面，move是刚走的或者刚退回的那步
+	void Update(const Position& pos, Move move) noexcept;
+
+	// 这个格子上的子能攻击到的格子，空格子返回空
+	Bitboard AttacksFrom(Square sq) const noexcept { return m_attacks[sq]; }
+	// 有多少个子攻击这个格子
+	int AttackCount(const Position& pos, PlayerType player, Square sq) const noexcept;
+	bool IsAttacked(PlayerType player, Square sq) const noexcept { return m_attacked[PlayerIndex(player)].Test(sq); }
+	// player一方能攻击到的所有格子
+	Bitboard Attacked(PlayerType player) const noexcept { return m_attacked[PlayerIndex(player)]; }
+	// player一方攻击sq的子，和Position::AttackersTo的区别是将帅照面也算
+	Bitboard AttackersTo(const Position& pos, Square sq, PlayerType player) const noexcept;
+
+private:
+	std::array<Bitboard, SQUARE_NB> m_attacks;
+	std::array<Bitboard, PLAYER_NB> m_attacked;
+
+	void UpdateAttacked(const Position& pos) noexcept;
+};
+
+} // namespace Carp
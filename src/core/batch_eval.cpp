@@ -0,0 +1,232 @@
+#include "batch_eval.h"
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "utils/async_output.h"
+#include "position.h"
+#include "search.h"
+#include "tt.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+// 每批的局面数，太小了线程之间抢队列，太大了最后几批不均匀
+constexpr std::size_t BATCH_SIZE = 256;
+// 最多读进来多少批还没处理的，免得输入很大时占满内存
+constexpr std::size_t MAX_PENDING_BATCHES = 64;
+// 输出缓冲攒到这么大再写
+constexpr std::size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+struct BatchItem
+{
+	std::string fen;
+	GameOutcome outcome;
+};
+
+using Batch = std::vector<BatchItem>;
+
+std::optional<BatchItem> ParseLine(std::string_view line)
+{
+	const auto separator = line.find(';');
+	auto fen = line.substr(0, separator);
+	while (!fen.empty() && (fen.back() == ' ' || fen.back() == '\r'))
+		fen.remove_suffix(1);
+	if (fen.empty())
+		return std::nullopt;
+
+	auto outcome = GameOutcome::Unknown;
+	if (separator != std::string_view::npos)
+	{
+		auto result = line.substr(separator + 1);
+		result.remove_prefix(std::min(result.find_first_not_of(' '), result.size()));
+		if (result.starts_with("1-0"))
+			outcome = GameOutcome::RedWin;
+		else if (result.starts_with("0-1"))
+			outcome = GameOutcome::BlackWin;
+		else if (result.starts_with("1/2"))
+			outcome = GameOutcome::Draw;
+	}
+	return BatchItem{ std::string{ fen }, outcome };
+}
+
+// 读线程往里放，工作线程从里面取，读完以后Close
+class BatchQueue
+{
+public:
+	void Push(Batch batch)
+	{
+		std::unique_lock lock(m_mutex);
+		m_cv.wait(lock, [this] { return m_batches.size() < MAX_PENDING_BATCHES; });
+		m_batches.push_back(std::move(batch));
+		m_cv.notify_all();
+	}
+
+	// 队列空了并且已经关闭时返回false
+	bool Pop(Batch& batch)
+	{
+		std::unique_lock lock(m_mutex);
+		m_cv.wait(lock, [this] { return !m_batches.empty() || m_closed; });
+		if (m_batches.empty())
+			return false;
+		batch = std::move(m_batches.front());
+		m_batches.pop_front();
+		m_cv.notify_all();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard lock(m_mutex);
+		m_closed = true;
+		m_cv.notify_all();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<Batch> m_batches;
+	bool m_closed = false;
+};
+
+} // namespace
+
+PackedEntry PackEntry(const Position& pos, Value score, GameOutcome outcome) noexcept
+{
+	PackedEntry entry{};
+	for (Square sq = 0; sq < SQUARE_NB; sq++)
+		entry.board[sq / 2] |= static_cast<std::uint8_t>(PieceIndex(pos.PieceOn(sq)) << (sq % 2 * 4));
+	entry.flags = static_cast<std::uint8_t>((pos.SideToMove() == PlayerType::Black ? 1 : 0) | (static_cast<std::uint8_t>(outcome) << 1));
+	entry.score = static_cast<std::int16_t>(score);
+	return entry;
+}
+
+std::string UnpackFen(const PackedEntry& entry)
+{
+	constexpr std::string_view PIECE_CHARS = "KABNRCP?kabnrcp";
+	std::string fen;
+	for (int rank = BOARD_RANK_NB - 1; rank >= 0; rank--)
+	{
+		int empty = 0;
+		for (int file = 0; file < BOARD_FILE_NB; file++)
+		{
+			const auto sq = MakeSquare(file, rank);
+			const auto piece = (entry.board[sq / 2] >> (sq % 2 * 4)) & 0x0f;
+			if (piece == PieceIndex(PlayerPieceType::None))
+			{
+				empty++;
+				continue;
+			}
+			if (empty > 0)
+				fen += static_cast<char>('0' + empty);
+			empty = 0;
+			fen += PIECE_CHARS[piece];
+		}
+		if (empty > 0)
+			fen += static_cast<char>('0' + empty);
+		if (rank > 0)
+			fen += '/';
+	}
+	fen += (entry.flags & 1) ? " b - - 0 1" : " w - - 0 1";
+	return fen;
+}
+
+BatchEvalStats EvaluateBatch(std::istream& in, std::ostream& out, const BatchEvalConfig& config)
+{
+	BatchQueue queue;
+	std::mutex out_mutex;
+	BatchEvalStats total;
+	// 搜索不会输出，这里只是满足Search的接口
+	AsyncOutput silent_output(std::cerr);
+
+	auto worker = [&]() {
+		TranspositionTable tt;
+		tt.Resize(config.hash_mb);
+		Search search(silent_output, tt);
+		SearchLimits limits;
+		limits.depth = config.depth;
+
+		BatchEvalStats stats;
+		std::vector<PackedEntry> buffer;
+		buffer.reserve(WRITE_BUFFER_SIZE / sizeof(PackedEntry));
+		auto flush = [&]() {
+			std::lock_guard lock(out_mutex);
+			out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(PackedEntry)));
+			buffer.clear();
+		};
+
+		Position pos;
+		Batch batch;
+		while (queue.Pop(batch))
+		{
+			for (const auto& item : batch)
+			{
+				if (!pos.SetFen(item.fen))
+				{
+					stats.skipped++;
+					continue;
+				}
+				const auto result = search.SearchNow(pos, limits);
+				stats.nodes += result.nodes;
+				if (!result.best)
+				{
+					stats.skipped++;
+					continue;
+				}
+				buffer.push_back(PackEntry(pos, result.score, item.outcome));
+				stats.positions++;
+				if (buffer.size() == buffer.capacity())
+					flush();
+			}
+		}
+		flush();
+
+		std::lock_guard lock(out_mutex);
+		total.positions += stats.positions;
+		total.skipped += stats.skipped;
+		total.nodes += stats.nodes;
+	};
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < std::max<std::size_t>(config.threads, 1); i++)
+		threads.emplace_back(worker);
+
+	Batch batch;
+	batch.reserve(BATCH_SIZE);
+	std::uint64_t bad_lines = 0;
+	for (std::string line; std::getline(in, line); )
+	{
+		auto item = ParseLine(line);
+		if (!item.has_value())
+		{
+			bad_lines += !line.empty();
+			continue;
+		}
+		batch.push_back(std::move(*item));
+		if (batch.size() == BATCH_SIZE)
+		{
+			queue.Push(std::move(batch));
+			batch = Batch{};
+			batch.reserve(BATCH_SIZE);
+		}
+	}
+	if (!batch.empty())
+		queue.Push(std::move(batch));
+	queue.Close();
+
+	for (auto& thread : threads)
+		thread.join();
+	out.flush();
+	total.skipped += bad_lines;
+	return total;
+}
+
+} // namespace Carp
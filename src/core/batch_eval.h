@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include "def.h"
+
+namespace Carp
+{
+
+class Position;
+
+// 对局结果，都是红方的角度，输入里没有给出时是Unknown
+enum class GameOutcome : std::uint8_t
+{
+	BlackWin = 0,
+	Draw = 1,
+	RedWin = 2,
+	Unknown = 3,
+};
+
+// 训练数据的一条记录，一共48字节，直接按内存布局写进文件（小端）
+struct PackedEntry
+{
+	// 每个格子4位，值是PlayerPieceType，空格子是None，格子0在低4位
+	std::array<std::uint8_t, (SQUARE_NB + 1) / 2> board;
+	// 第0位是走子方（1表示黑方），第1、2位是GameOutcome
+	std::uint8_t flags;
+	// 固定深度搜索的分数，走子方的角度
+	std::int16_t score;
+};
+
+static_assert(sizeof(PackedEntry) == 48);
+
+PackedEntry PackEntry(const Position& pos, Value score, GameOutcome outcome) noexcept;
+// 还原成FEN，用来检查生成的数据
+std::string UnpackFen(const PackedEntry& entry);
+
+struct BatchEvalConfig
+{
+	int depth = 6;
+	std::size_t threads = 1;
+	// 每个线程自己的置换表大小（MB）
+	std::size_t hash_mb = 16;
+};
+
+struct BatchEvalStats
+{
+	std::uint64_t positions = 0;
+	// 格式错误、没有合法走法的局面不输出
+	std::uint64_t skipped = 0;
+	std::uint64_t nodes = 0;
+};
+
+// 从in读局面，每行一个FEN，后面可以跟" ; 1-0"、" ; 0-1"或者" ; 1/2-1/2"表示对局结果
+// 多个线程各自搜索一批局面，结果攒成大块写到out，输出的顺序和输入不一定一致
+BatchEvalStats EvaluateBatch(std::istream& in, std::ostream& out, const BatchEvalConfig& config);
+
+} // namespace Carp
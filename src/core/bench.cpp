@@ -0,0 +1,166 @@
+#include "bench.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include "utils/async_output.h"
+#include "attack.h"
+#include "attack_map.h"
+#include "movegen.h"
+#include "position.h"
+#include "search.h"
+#include "tt.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+constexpr std::string_view BENCH_FENS[] = {
+	START_FEN,
+	"rnbakab1r/4n4/4c4/p1C1p3p/1C2c1p2/2PN4P/P5P2/9/9/1RBAKABNR b - - 11 1",
+	"r1bakab1r/4n4/n5c2/p1C1p4/1C6p/2PN2p2/P5c2/4B3N/4A4/1RB1KAR2 w - - 2 1",
+	"r1bakab1r/4n4/4c4/6R2/p3N4/2P1C4/P8/4B3p/4A4/1RB1KA3 b - - 4 1",
+	"r1bakab1r/6n2/2n1c4/pCN1p3p/2P6/6p2/P3P1c1P/4C1N2/9/R1BAKAB1R b - - 4 1",
+	"2ra1ab1r/4k4/4b4/p7p/9/4P1B2/P5c1P/6N2/9/R1BAKA2R w - - 2 1",
+	"3akar2/9/4b4/p7p/9/4r3P/P4c3/4B4/4N4/R1BAKA2R b - - 7 1",
+	"3aka3/9/4b4/p8/8p/P1Bcr4/6r2/4B3R/2R1N4/3AKA3 w - - 0 1",
+	"r1bakab1r/4n4/1c4n2/p1p1p3p/6C2/2P5P/P3c1P2/1C2N4/4A4/R1B1KABNR b - - 0 1",
+	"r1bakab1r/2n6/6n2/p1p1p3p/3C2P2/4c3P/P3N1N2/c8/4A4/R1B1KAB1R w - - 0 1",
+	"1rbakab1r/5n3/4n4/p1p2P2p/1C2N4/8P/P1N6/4B4/4A4/Rc2KAB1R b - - 6 1",
+	"1R1akab1r/5n3/9/p2P4p/2b1C4/8P/P1p6/4B4/4A4/4KAB1R w - - 4 1",
+	"1rbakabnr/9/2c6/R3p1p1p/2P6/2B3P2/4P3P/4C4/4A4/1Nc1KABNR b - - 2 1",
+	"2baka1n1/3r5/2c1b4/2R3p1p/3P5/2B3P2/4P3P/3KC4/4r4/3c2BNR w - - 6 1",
+	"3akab2/9/4b4/p3p1p1p/2p6/2P3P2/P3P3P/4B4/4A4/2BAK4 w - - 0 1",
+};
+
+constexpr std::size_t BENCH_HASH = 16;
+
+template <typename F>
+BenchResult ForEachBench(int depth, F&& on_position)
+{
+	// 搜索不输出，只是满足Search的接口
+	AsyncOutput silent_output(std::cerr);
+	TranspositionTable tt;
+	tt.Resize(BENCH_HASH);
+	Search search(silent_output, tt);
+	SearchLimits limits;
+	limits.depth = depth;
+
+	BenchResult total{ 0, 0 };
+	const auto start = std::chrono::steady_clock::now();
+	Position pos;
+	for (std::size_t i = 0; i < std::size(BENCH_FENS); i++)
+	{
+		pos.SetFen(BENCH_FENS[i]);
+		const auto result = search.SearchNow(pos, limits);
+		total.nodes += result.nodes;
+		on_position(i, result);
+	}
+	total.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	return total;
+}
+
+struct AttackQueryTotals
+{
+	std::uint64_t nodes = 0;
+	std::uint64_t checkers = 0;
+	std::uint64_t attacked = 0;
+	std::int64_t time = 0;
+};
+
+template <bool INCREMENTAL>
+void AttackWalk(Position& pos, AttackMap& map, int depth, AttackQueryTotals& totals)
+{
+	totals.nodes++;
+	const auto us = pos.SideToMove();
+	const auto them = Opponent(us);
+	const auto king_sq = pos.KingSquare(us);
+	if constexpr (INCREMENTAL)
+	{
+		totals.checkers += map.AttackersTo(pos, king_sq, them).Count();
+		totals.attacked += (KingMoves(king_sq) & map.Attacked(them)).Count();
+	}
+	else
+	{
+		const auto occupied = pos.Occupied();
+		totals.checkers += pos.AttackersTo(king_sq, them, occupied).Count();
+		for (Bitboard bb = KingMoves(king_sq); bb; )
+			totals.attacked += pos.AttackersTo(bb.PopLsb(), them, occupied).Any();
+	}
+	if (depth == 0)
+		return;
+
+	MoveList list;
+	GenerateLegal<GenType::All>(pos, list);
+	for (const auto& [move, score] : list)
+	{
+		pos.MakeMove(move);
+		if constexpr (INCREMENTAL)
+			map.Update(pos, move);
+		AttackWalk<INCREMENTAL>(pos, map, depth - 1, totals);
+		pos.UnmakeMove();
+		if constexpr (INCREMENTAL)
+			map.Update(pos, move);
+	}
+}
+
+template <bool INCREMENTAL>
+AttackQueryTotals RunAttackWalk(int depth)
+{
+	AttackQueryTotals totals;
+	const auto start = std::chrono::steady_clock::now();
+	Position pos;
+	AttackMap map;
+	for (const auto fen : BENCH_FENS)
+	{
+		pos.SetFen(fen);
+		map.Init(pos);
+		AttackWalk<INCREMENTAL>(pos, map, depth, totals);
+	}
+	totals.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	return totals;
+}
+
+} // namespace
+
+BenchResult RunBench(int depth)
+{
+	return ForEachBench(depth, [](std::size_t, const SearchResult&) {});
+}
+
+std::string BenchReport(int depth)
+{
+	std::ostringstream report;
+	const auto total = ForEachBench(depth, [&report](std::size_t index, const SearchResult& result) {
+		report << "info string bench position " << index + 1 << " nodes " << result.nodes
+			<< " bestmove " << result.best.ToString() << "\n";
+	});
+	const auto nps = total.time > 0 ? total.nodes * 1000 / static_cast<std::uint64_t>(total.time) : total.nodes;
+	report << "info string bench depth " << depth << " nodes " << total.nodes << " time " << total.time << " nps " << nps;
+	return report.str();
+}
+
+std::string AttackMapBenchReport(int depth)
+{
+	const auto recompute = RunAttackWalk<false>(depth);
+	const auto incremental = RunAttackWalk<true>(depth);
+
+	std::ostringstream report;
+	auto print = [&report](std::string_view name, const AttackQueryTotals& totals) {
+		const auto ns = totals.nodes > 0 ? static_cast<double>(totals.time) * 1000.0 / static_cast<double>(totals.nodes) : 0.0;
+		report << "info string attacks " << name << " nodes " << totals.nodes << " time " << totals.time / 1000
+			<< " ns/node " << static_cast<std::int64_t>(ns + 0.5) << "\n";
+	};
+	print("recompute", recompute);
+	print("incremental", incremental);
+	const bool match = recompute.checkers == incremental.checkers && recompute.attacked == incremental.attacked;
+	const auto ratio = incremental.time > 0 ? static_cast<double>(recompute.time) / static_cast<double>(incremental.time) : 0.0;
+	report << "info string attacks depth " << depth << " speedup " << std::fixed << std::setprecision(2) << ratio << "x"
+		<< (match ? " results match" : " results MISMATCH");
+	return report.str();
+}
+
+} // namespace Carp
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Carp
+{
+
+constexpr int DEFAULT_BENCH_DEPTH = 8;
+
+struct BenchResult
+{
+	std::uint64_t nodes;
+	std::int64_t time;
+};
+
+// 单线程按固定深度搜索一组内置局面，节点数只和代码有关，可以用来检查改动有没有影响搜索
+// 也是PGO收集数据时跑的负载
+BenchResult RunBench(int depth);
+// 输出成info string，最后一行是总节点数和速度
+std::string BenchReport(int depth);
+
+constexpr int DEFAULT_ATTACK_BENCH_DEPTH = 3;
+
+// 在内置局面上按固定深度走遍所有走法，每个节点查询将军和己方将帅周围被攻击的格子，
+// 分别用增量攻击表和重新计算来做，比较两者的速度并检查结果是否一致
+std::string AttackMapBenchReport(int depth);
+
+} // namespace Carp
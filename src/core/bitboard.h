@@ -0,0 +1,78 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include "def.h"
+
+namespace Carp
+{
+
+// 90个格子的位棋盘，低64个格子放在m_lo，剩下26个格子放在m_hi
+class Bitboard
+{
+public:
+	constexpr Bitboard() noexcept = default;
+	constexpr Bitboard(std::uint64_t lo, std::uint64_t hi) noexcept : m_lo(lo), m_hi(hi) {}
+
+	constexpr static Bitboard FromSquare(Square sq) noexcept
+	{
+		return sq < 64 ? Bitboard{ std::uint64_t{ 1 } << sq, 0 } : Bitboard{ 0, std::uint64_t{ 1 } << (sq - 64) };
+	}
+
+	constexpr std::uint64_t Low() const noexcept { return m_lo; }
+	constexpr std::uint64_t High() const noexcept { return m_hi; }
+
+	constexpr bool Test(Square sq) const noexcept
+	{
+		return sq < 64 ? ((m_lo >> sq) & 1) != 0 : ((m_hi >> (sq - 64)) & 1) != 0;
+	}
+
+	constexpr bool Any() const noexcept { return (m_lo | m_hi) != 0; }
+	constexpr explicit operator bool() const noexcept { return Any(); }
+	constexpr int Count() const noexcept { return std::popcount(m_lo) + std::popcount(m_hi); }
+	// 是否多于一个格子
+	constexpr bool MoreThanOne() const noexcept
+	{
+		return (m_lo & (m_lo - 1)) != 0 || (m_hi & (m_hi - 1)) != 0 || (m_lo != 0 && m_hi != 0);
+	}
+
+	// 最低位的格子，调用前需要保证不为空
+	constexpr Square Lsb() const noexcept
+	{
+		return m_lo != 0 ? static_cast<Square>(std::countr_zero(m_lo)) : static_cast<Square>(64 + std::countr_zero(m_hi));
+	}
+
+	constexpr Square PopLsb() noexcept
+	{
+		const Square sq = Lsb();
+		if (m_lo != 0)
+			m_lo &= m_lo - 1;
+		else
+			m_hi &= m_hi - 1;
+		return sq;
+	}
+
+	constexpr bool operator==(const Bitboard&) const noexcept = default;
+
+	constexpr Bitboard operator&(const Bitboard& other) const noexcept { return { m_lo & other.m_lo, m_hi & other.m_hi }; }
+	constexpr Bitboard operator|(const Bitboard& other) const noexcept { return { m_lo | other.m_lo, m_hi | other.m_hi }; }
+	constexpr Bitboard operator^(const Bitboard& other) const noexcept { return { m_lo ^ other.m_lo, m_hi ^ other.m_hi }; }
+	constexpr Bitboard operator~() const noexcept { return { ~m_lo, ~m_hi & HIGH_MASK }; }
+	constexpr Bitboard& operator&=(const Bitboard& other) noexcept { m_lo &= other.m_lo; m_hi &= other.m_hi; return *this; }
+	constexpr Bitboard& operator|=(const Bitboard& other) noexcept { m_lo |= other.m_lo; m_hi |= other.m_hi; return *this; }
+	constexpr Bitboard& operator^=(const Bitboard& other) noexcept { m_lo ^= other.m_lo; m_hi ^= other.m_hi; return *this; }
+
+	constexpr Bitboard operator&(Square sq) const noexcept { return *this & FromSquare(sq); }
+	constexpr Bitboard operator|(Square sq) const noexcept { return *this | FromSquare(sq); }
+	constexpr Bitboard operator^(Square sq) const noexcept { return *this ^ FromSquare(sq); }
+	constexpr Bitboard& operator|=(Square sq) noexcept { return *this |= FromSquare(sq); }
+	constexpr Bitboard& operator^=(Square sq) noexcept { return *this ^= FromSquare(sq); }
+
+private:
+	static constexpr std::uint64_t HIGH_MASK = (std::uint64_t{ 1 } << (SQUARE_NB - 64)) - 1;
+
+	std::uint64_t m_lo = 0;
+	std::uint64_t m_hi = 0;
+};
+
+} // namespace Carp
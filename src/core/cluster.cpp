@@ -0,0 +1,328 @@
+#include "cluster.h"
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include "utils/async_output.h"
+#include "utils/engine_process.h"
+#include "movegen.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+// 启动工作进程时等ucciok的时间
+constexpr std::int64_t STARTUP_TIMEOUT_MS = 10000;
+// 转发给工作进程的时间要扣掉管道来回的开销
+constexpr std::int64_t CLUSTER_OVERHEAD = 20;
+constexpr std::int64_t POLL_INTERVAL_MS = 10;
+// 每隔这么久让各进程导出一次置换表项
+constexpr auto EXCHANGE_INTERVAL = std::chrono::milliseconds(500);
+// 没有指定命令时启动自己
+constexpr std::string_view SELF_EXECUTABLE = "/proc/self/exe";
+
+std::vector<std::string_view> SplitWords(std::string_view line)
+{
+	std::vector<std::string_view> words;
+	while (!line.empty())
+	{
+		const auto start = line.find_first_not_of(' ');
+		if (start == std::string_view::npos)
+			break;
+		const auto end = line.find(' ', start);
+		words.push_back(line.substr(start, end - start));
+		if (end == std::string_view::npos)
+			break;
+		line = line.substr(end);
+	}
+	return words;
+}
+
+template <typename T>
+bool ParseWord(std::string_view word, T& value) noexcept
+{
+	return std::from_chars(word.data(), word.data() + word.size(), value).ec == std::errc{};
+}
+
+} // namespace
+
+struct ClusterSearch::Worker
+{
+	EngineProcess process;
+	// 本次搜索分到的根节点走法
+	std::vector<Move> moves;
+	bool searching = false;
+	int depth = 0;
+	Value score = -VALUE_INFINITE;
+	std::uint64_t nodes = 0;
+	std::vector<Move> pv;
+	Move best;
+	Move ponder;
+
+	void Reset()
+	{
+		moves.clear();
+		searching = false;
+		depth = 0;
+		score = -VALUE_INFINITE;
+		nodes = 0;
+		pv.clear();
+		best = ponder = Move{};
+	}
+};
+
+ClusterSearch::ClusterSearch(AsyncOutput& output) :
+	m_output(output),
+	m_channel(output.CreateChannel()) {}
+
+ClusterSearch::~ClusterSearch()
+{
+	Stop();
+	Wait();
+	m_output.RemoveChannel(m_channel);
+}
+
+bool ClusterSearch::SetWorkers(std::size_t count, const std::string& command, std::size_t threads, std::size_t hash_mb)
+{
+	Stop();
+	Wait();
+	m_workers.clear();
+	for (std::size_t i = 0; i < count; i++)
+	{
+		auto worker = std::make_unique<Worker>();
+		const bool started = command.empty() ? worker->process.Start(std::string{ SELF_EXECUTABLE }) : worker->process.StartShell(command);
+		if (!started || !worker->process.Send("ucci") || !worker->process.WaitFor("ucciok", STARTUP_TIMEOUT_MS))
+		{
+			m_workers.clear();
+			return false;
+		}
+		worker->process.Send("setoption threads " + std::to_string(threads));
+		worker->process.Send("setoption hash " + std::to_string(hash_mb));
+		m_workers.push_back(std::move(worker));
+	}
+	return true;
+}
+
+void ClusterSearch::Start(const std::string& position, const Position& pos, const SearchLimits& limits, const OutputSearch& output_format)
+{
+	Wait();
+	m_stop = false;
+	m_limits = limits;
+	m_output_format = &output_format;
+	m_start_time = std::chrono::steady_clock::now();
+
+	MoveList legal;
+	GenerateLegal<GenType::All>(pos, legal);
+	std::vector<Move> root_moves;
+	for (const auto move : limits.search_moves)
+	{
+		if (legal.Contains(move) && std::ranges::find(root_moves, move) == root_moves.end())
+			root_moves.push_back(move);
+	}
+	if (root_moves.empty())
+	{
+		for (const auto& scored : legal)
+			root_moves.push_back(scored.move);
+	}
+	if (root_moves.empty())
+	{
+		m_output.WriteNow(output_format.BestMove(Move{}, Move{}, false));
+		return;
+	}
+
+	// 轮流分配，走法比进程少的时候多出来的进程这次不用
+	for (auto& worker : m_workers)
+		worker->Reset();
+	for (std::size_t i = 0; i < root_moves.size(); i++)
+		m_workers[i % m_workers.size()]->moves.push_back(root_moves[i]);
+	for (auto& worker : m_workers)
+	{
+		if (worker->moves.empty())
+			continue;
+		worker->searching = worker->process.Send("position " + position) && worker->process.Send(GoCommand(*worker));
+	}
+	m_thread = std::thread(&ClusterSearch::Run, this);
+}
+
+void ClusterSearch::Wait()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+std::string ClusterSearch::GoCommand(const Worker& worker) const
+{
+	const auto active = static_cast<std::uint64_t>(std::ranges::count_if(m_workers, [](const auto& w) { return !w->moves.empty(); }));
+	std::ostringstream os;
+	os << "go";
+	if (m_limits.infinite)
+		os << " infinite";
+	if (m_limits.depth < MAX_PLY)
+		os << " depth " << m_limits.depth;
+	// 节点数是所有进程加起来的
+	if (m_limits.nodes.has_value())
+		os << " nodes " << std::max<std::uint64_t>(*m_limits.nodes / active, 1);
+	if (m_limits.move_time.has_value())
+		os << " movetime " << std::max<std::int64_t>(*m_limits.move_time - CLUSTER_OVERHEAD, 1);
+	if (m_limits.time.has_value())
+	{
+		os << " time " << std::max<std::int64_t>(*m_limits.time - CLUSTER_OVERHEAD, 1) << " increment " << m_limits.increment;
+		if (m_limits.moves_to_go > 0)
+			os << " movestogo " << m_limits.moves_to_go;
+	}
+	if (m_limits.mate.has_value())
+		os << " mate " << *m_limits.mate;
+	os << " searchmoves";
+	for (const auto move : worker.moves)
+		os << ' ' << move.ToString();
+	return os.str();
+}
+
+void ClusterSearch::Run()
+{
+	std::vector<EngineProcess*> processes;
+	for (auto& worker : m_workers)
+		processes.push_back(&worker->process);
+
+	auto last_exchange = std::chrono::steady_clock::now();
+	bool stop_sent = false;
+	std::vector<std::pair<const Worker*, std::string>> exchange;
+	auto any_searching = [this] { return std::ranges::any_of(m_workers, [](const auto& w) { return w->searching; }); };
+	while (any_searching())
+	{
+		if (m_stop && !stop_sent)
+		{
+			for (auto& worker : m_workers)
+			{
+				if (worker->searching)
+					worker->process.Send("stop");
+			}
+			stop_sent = true;
+		}
+
+		EngineProcess::WaitForOutput(processes, POLL_INTERVAL_MS);
+		for (auto& worker : m_workers)
+		{
+			while (auto line = worker->process.TryReadLine())
+				HandleLine(*worker, *line, exchange);
+			// 进程意外退出了，它分到的走法就不算了
+			if (worker->searching && worker->process.OutputClosed())
+				worker->searching = false;
+		}
+
+		// 一个进程导出的项一次性转发给其它还在搜索的进程
+		if (!exchange.empty())
+		{
+			for (auto& worker : m_workers)
+			{
+				if (!worker->searching)
+					continue;
+				std::string batch;
+				for (const auto& [from, line] : exchange)
+				{
+					if (from == worker.get())
+						continue;
+					if (!batch.empty())
+						batch += '\n';
+					batch += line;
+				}
+				if (!batch.empty())
+					worker->process.Send(batch);
+			}
+			exchange.clear();
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (!stop_sent && now - last_exchange >= EXCHANGE_INTERVAL)
+		{
+			for (auto& worker : m_workers)
+			{
+				if (worker->searching)
+					worker->process.Send("hashexport");
+			}
+			last_exchange = now;
+		}
+	}
+
+	const auto* best = BestWorker();
+	m_output.WriteNow(m_output_format->BestMove(best ? best->best : Move{}, best ? best->ponder : Move{}, false));
+}
+
+void ClusterSearch::HandleLine(Worker& worker, std::string_view line, std::vector<std::pair<const Worker*, std::string>>& exchange)
+{
+	constexpr std::string_view HASH_ENTRY = "hashentry ";
+	if (line.starts_with(HASH_ENTRY))
+	{
+		exchange.emplace_back(&worker, "hashimport " + std::string{ line.substr(HASH_ENTRY.size()) });
+		return;
+	}
+
+	const auto words = SplitWords(line);
+	if (words.empty())
+		return;
+	if (words[0] == "bestmove" || words[0] == "nobestmove")
+	{
+		if (words[0] == "bestmove" && words.size() >= 2)
+			worker.best = Move::FromString(words[1]);
+		if (words.size() >= 4 && words[2] == "ponder")
+			worker.ponder = Move::FromString(words[3]);
+		worker.searching = false;
+		return;
+	}
+	if (words[0] != "info")
+		return;
+
+	// UCCI的info：info depth <d> score <s> time <t> nodes <n> pv <moves>
+	int depth = 0;
+	Value score = 0;
+	std::vector<Move> pv;
+	for (std::size_t i = 1; i < words.size(); i++)
+	{
+		if (words[i] == "pv")
+		{
+			for (i++; i < words.size(); i++)
+				pv.push_back(Move::FromString(words[i]));
+			break;
+		}
+		if (i + 1 >= words.size())
+			break;
+		if (words[i] == "depth")
+			ParseWord(words[++i], depth);
+		else if (words[i] == "score")
+			ParseWord(words[++i], score);
+		else if (words[i] == "nodes")
+			ParseWord(words[++i], worker.nodes);
+	}
+	if (depth <= 0 || pv.empty() || !pv.front())
+		return;
+	worker.depth = depth;
+	worker.score = score;
+	worker.pv = std::move(pv);
+	worker.best = worker.pv.front();
+	worker.ponder = worker.pv.size() >= 2 ? worker.pv[1] : Move{};
+
+	// 只输出当前最好的那个进程的结果，节点数是所有进程加起来的
+	if (BestWorker() != &worker)
+		return;
+	std::uint64_t nodes = 0;
+	for (const auto& w : m_workers)
+		nodes += w->nodes;
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start_time).count();
+	m_channel->Post(InfoKind::Pv, m_output_format->Info(SearchInfo{ worker.depth, worker.depth, worker.score, nodes, elapsed, worker.pv }));
+}
+
+const ClusterSearch::Worker* ClusterSearch::BestWorker() const noexcept
+{
+	const Worker* best = nullptr;
+	for (const auto& worker : m_workers)
+	{
+		if (!worker->best)
+			continue;
+		if (best == nullptr || worker->score > best->score || (worker->score == best->score && worker->depth > best->depth))
+			best = worker.get();
+	}
+	return best;
+}
+
+} // namespace Carp
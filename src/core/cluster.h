@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "def.h"
+#include "move.h"
+#include "position.h"
+#include "search.h"
+
+namespace Carp
+{
+
+class AsyncOutput;
+class InfoChannel;
+class EngineProcess;
+
+// 分布式搜索：根节点的走法分给多个工作进程，每个进程用searchmoves只搜自己那一份
+// 工作进程说UCCI，另外有hashexport和hashimport两个扩展命令，
+// 协调进程定期把每个进程主要变例上的置换表项转发给其它进程
+// 工作进程通过管道启动，命令可以是ssh之类的，所以可以跨机器，数量不受本机核心数限制
+class ClusterSearch
+{
+public:
+	explicit ClusterSearch(AsyncOutput& output);
+	~ClusterSearch();
+	ClusterSearch(const ClusterSearch&) = delete;
+	ClusterSearch& operator=(const ClusterSearch&) = delete;
+
+	// 启动count个工作进程，每个用threads个线程和hash_mb的置换表，失败时返回false，已经启动的会被关掉
+	bool SetWorkers(std::size_t count, const std::string& command, std::size_t threads, std::size_t hash_mb);
+	std::size_t WorkerCount() const noexcept { return m_workers.size(); }
+
+	// position是position命令后面的部分，原样转发给工作进程，pos是对应的局面，用来分配走法
+	void Start(const std::string& position, const Position& pos, const SearchLimits& limits, const OutputSearch& output_format);
+	void Stop() noexcept { m_stop = true; }
+	void Wait();
+
+private:
+	struct Worker;
+
+	AsyncOutput& m_output;
+	// 转发工作进程的info，和本地搜索一样按输出间隔合并
+	InfoChannel* const m_channel;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::atomic<bool> m_stop{ false };
+	std::thread m_thread;
+
+	std::chrono::steady_clock::time_point m_start_time;
+	SearchLimits m_limits;
+	const OutputSearch* m_output_format = nullptr;
+
+	void Run();
+	void HandleLine(Worker& worker, std::string_view line, std::vector<std::pair<const Worker*, std::string>>& exchange);
+	// 当前分数最高的那个进程，没有的话返回nullptr
+	const Worker* BestWorker() const noexcept;
+	std::string GoCommand(const Worker& worker) const;
+};
+
+} // namespace Carp
@@ -33,6 +33,7 @@ enum class PlayerPieceType : std::uint8_t
     RedRook,
     RedCannon,
     RedPawn,
+    None,      // 空格子
     BlackKing = 8,
     BlackAdvisor,
     BlackElephant,
@@ -42,6 +43,63 @@ enum class PlayerPieceType : std::uint8_t
     BlackPawn,
 };
 
+constexpr int PLAYER_NB = 2;
+constexpr int PIECE_TYPE_NB = 7;
+constexpr int PLAYER_PIECE_NB = 16;
+
+// 红方是0，黑方是1，用作数组下标
+constexpr int PlayerIndex(PlayerType player)
+{
+    return static_cast<std::underlying_type_t<PlayerType>>(player) >> 3;
+}
+
+constexpr PlayerType Opponent(PlayerType player)
+{
+    return static_cast<PlayerType>(static_cast<std::underlying_type_t<PlayerType>>(player) ^ 0x08);
+}
+
+constexpr int PieceIndex(PlayerPieceType player_piece)
+{
+    return static_cast<std::underlying_type_t<PlayerPieceType>>(player_piece);
+}
+
+// 棋盘一共9列10行，格子编号为 行 * 9 + 列，红方底线是第0行，列从左往右是a到i
+constexpr int BOARD_FILE_NB = 9;
+constexpr int BOARD_RANK_NB = 10;
+constexpr int SQUARE_NB = BOARD_FILE_NB * BOARD_RANK_NB;
+
+using Square = std::uint8_t;
+
+constexpr Square MakeSquare(int file, int rank)
+{
+    return static_cast<Square>(rank * BOARD_FILE_NB + file);
+}
+
+constexpr int GetFile(Square sq)
+{
+    return sq % BOARD_FILE_NB;
+}
+
+constexpr int GetRank(Square sq)
+{
+    return sq / BOARD_FILE_NB;
+}
+
+// 分数都是从走子方的角度来看的
+using Value = int;
+
+// 搜索的最大层数
+constexpr int MAX_PLY = 128;
+
+constexpr Value VALUE_DRAW = 0;
+constexpr Value VALUE_MATE = 30000;
+constexpr Value VALUE_INFINITE = 32000;
+// 没有值，比如被将军时的静态评估
+constexpr Value VALUE_NONE = VALUE_INFINITE + 1;
+constexpr Value VALUE_MATE_IN_MAX_PLY = VALUE_MATE - MAX_PLY;
+// 长将判负，分数比杀棋低一点
+constexpr Value VALUE_PERPETUAL = VALUE_MATE_IN_MAX_PLY - 1;
+
 constexpr PlayerPieceType ComposePlayerPiece(PlayerType player, PieceType piece)
 {
     auto piece_val  = static_cast<std::underlying_type_t<PieceType>>(piece);
@@ -1,24 +1,293 @@
 #include "engine.h"
+#include <fstream>
+#include <iostream>
 #include "protocol/option.h"
+#include "utils/async_output.h"
+#include "utils/task_runner.h"
+#include "utils/trace.h"
+#include "cluster.h"
+#include "eval_hash.h"
+#include "movegen.h"
+#include "search.h"
+#include "tactics.h"
+#include "tt.h"
+#include "tt_exchange.h"
 
 namespace Carp
 {
 
-void Engine::InitOptions(OptionContainer& container) const
+constexpr int DEFAULT_THREADS = 2;
+constexpr int DEFAULT_HASH = 16;
+constexpr int DEFAULT_EVAL_HASH = 0;
+
+Engine::Engine() : Engine(std::cout, SharedResources{}) {}
+
+Engine::Engine(std::ostream& os, const SharedResources& shared) :
+	m_output(std::make_unique<AsyncOutput>(os)),
+	m_tt(shared.tt ? shared.tt : std::make_shared<TranspositionTable>()),
+	m_shared_tt(shared.tt != nullptr),
+	m_eval_hash(std::make_unique<EvalHash>()),
+	m_search(std::make_unique<Search>(*m_output, *m_tt)),
+	m_cluster(std::make_unique<ClusterSearch>(*m_output)),
+	m_tasks(std::make_unique<TaskRunner>())
 {
-	container.AddOption<OptionSpin>("Threads", 2, 1, 1024, [](const Option& option)->void {
+	if (!m_shared_tt)
+		m_tt->Resize(DEFAULT_HASH);
+	m_search->SetThreadBudget(shared.thread_budget);
+	m_search->SetThreads(DEFAULT_THREADS);
+	m_eval_hash->Resize(DEFAULT_EVAL_HASH);
+	m_search->SetEvalHash(m_eval_hash.get());
+	m_game.fen = m_position.GetFen();
+}
 
-		});
-	container.AddOption<OptionSpin>("Hash", 16, 1, 33554432, [](const Option& option)->void {
+Engine::~Engine() = default;
 
+void Engine::InitOptions(OptionContainer& container)
+{
+	// 要动搜索线程和置换表的选项都放到后台按顺序执行，命令线程马上返回，isready和下一次搜索之前会等它们完成
+	container.AddOption<OptionSpin>("Threads", DEFAULT_THREADS, 1, 1024, [this](const Option& option)->void {
+		const auto count = static_cast<std::size_t>(static_cast<const OptionSpin&>(option).Get());
+		PostOptionTask([this, count] { m_search->SetThreads(count); });
+		m_cluster_dirty = m_cluster_workers > 0;
 		});
-	container.AddOption<OptionButton>("Clear Hash", [](const Option& option)->void {
-
+	// 服务器模式下置换表是其它会话共用的，大小由服务器决定，也不能被某一个会话清空
+	if (!m_shared_tt)
+	{
+		// 分配失败时保留原来的表
+		container.AddOption<OptionSpin>("Hash", DEFAULT_HASH, 1, 33554432, [this](const Option& option)->void {
+			const auto mb = static_cast<std::size_t>(static_cast<const OptionSpin&>(option).Get());
+			PostOptionTask([this, mb] { m_tt->Resize(mb); });
+			m_cluster_dirty = m_cluster_workers > 0;
+			});
+		container.AddOption<OptionButton>("Clear Hash", [this]([[maybe_unused]] const Option& option)->void {
+			PostOptionTask([this] {
+				m_tt->Clear();
+				m_search->Clear();
+				});
+			});
+		// 启动后第一次搜索之前读入这个置换表文件，长时间分析时不用每次重新算
+		container.AddOption<OptionString>("Hash Autoload", "<empty>", [this](const Option& option)->void {
+			const auto path = static_cast<const OptionString&>(option).Get();
+			m_hash_autoload = path == "<empty>" ? "" : std::string{ path };
+			});
+		// 回归测试用，配合go nodes，结果可以重现
+		container.AddOption<OptionCheck>("Deterministic", false, [this](const Option& option)->void {
+			const bool deterministic = static_cast<const OptionCheck&>(option).Get();
+			PostOptionTask([this, deterministic] { m_search->SetDeterministic(deterministic); });
+			});
+		// 分布式搜索的工作进程数，0表示只在本进程搜索，工作进程的Threads和Hash和本进程一样
+		// 服务器模式下不提供：Cluster Command会交给shell执行，不能让套接字的客户端设置
+		container.AddOption<OptionSpin>("Cluster Workers", 0, 0, 256, [this](const Option& option)->void {
+			m_cluster_workers = static_cast<std::size_t>(static_cast<const OptionSpin&>(option).Get());
+			m_cluster_dirty = true;
+			});
+		// 启动工作进程的命令，默认启动自己，也可以是"ssh host Carp"之类的
+		container.AddOption<OptionString>("Cluster Command", "<self>", [this](const Option& option)->void {
+			const auto command = static_cast<const OptionString&>(option).Get();
+			m_cluster_command = command == "<self>" ? "" : std::string{ command };
+			m_cluster_dirty = m_cluster_workers > 0;
+			});
+	}
+	// 静态评估的缓存，每个会话自己一份，0表示不用
+	// 现在的手写评估比一次缓存未命中还快，默认不开，换成网络评估以后再打开
+	container.AddOption<OptionSpin>("Eval Hash", DEFAULT_EVAL_HASH, 0, 4096, [this](const Option& option)->void {
+		const auto mb = static_cast<std::size_t>(static_cast<const OptionSpin&>(option).Get());
+		PostOptionTask([this, mb] { m_eval_hash->Resize(mb); });
+		});
+	// savehash和loadhash绕过页缓存，表很大的时候不会把其它东西挤出缓存
+	container.AddOption<OptionCheck>("Hash Direct IO", false, [this](const Option& option)->void {
+		m_hash_direct_io = static_cast<const OptionCheck&>(option).Get();
+		});
+	// 走子前预取子节点的置换表项，Hash很大的时候效果明显，可以关掉和stats的结果对比
+	container.AddOption<OptionCheck>("TT Prefetch", true, [this](const Option& option)->void {
+		const bool prefetch = static_cast<const OptionCheck&>(option).Get();
+		PostOptionTask([this, prefetch] { m_search->SetPrefetch(prefetch); });
 		});
 	container.AddOption<OptionCheck>("Ponder", false);
 	container.AddOption<OptionSpin>("MultiPV", 1, 1, 128);
 	container.AddOption<OptionCombo>("Repetition Rule", "AsianRule", std::vector<std::string>{"AsianRule", "ChineseRule"});
 	container.AddOption<OptionString>("EvalFile", "placeholder.txt");
+	// 每次搜索结束时把时间线写成Chrome trace，只有打开了跟踪的版本才有这个选项
+	if constexpr (TRACE_ENABLED)
+	{
+		container.AddOption<OptionString>("Trace File", "<empty>", [this](const Option& option)->void {
+			auto path = std::string{ static_cast<const OptionString&>(option).Get() };
+			if (path == "<empty>")
+				path.clear();
+			PostOptionTask([this, path = std::move(path)] { m_search->SetTraceFile(path); });
+			});
+	}
+	// 搜索时info的最短输出间隔（毫秒），间隔内同类的info只输出最新的
+	container.AddOption<OptionSpin>("Info Interval", 100, 1, 5000, [this](const Option& option)->void {
+		m_output->SetInterval(static_cast<const OptionSpin&>(option).Get());
+		});
+}
+
+bool Engine::SetPosition(std::string_view fen, std::span<const std::string_view> moves)
+{
+	Position pos;
+	if (!pos.SetFen(fen))
+		return false;
+	for (auto move_str : moves)
+	{
+		const auto move = Move::FromString(move_str);
+		if (!pos.CanMakeMove() || !IsLegalMove(pos, move))
+			return false;
+		pos.MakeMove(move);
+	}
+	m_position = pos;
+	m_game.fen = fen;
+	m_game.moves.clear();
+	for (auto move_str : moves)
+		m_game.moves.push_back(Move::FromString(move_str));
+	return true;
+}
+
+void Engine::Go(const SearchLimits& limits, const OutputSearch& output_format)
+{
+	StopAndWait();
+	if (!m_hash_autoload.empty())
+	{
+		m_output->WriteNow(LoadHash(m_hash_autoload));
+		m_hash_autoload.clear();
+	}
+	if (m_cluster_dirty)
+		UpdateCluster();
+	if (m_cluster->WorkerCount() > 0)
+	{
+		std::string position_command = "fen " + m_game.fen;
+		if (!m_game.moves.empty())
+			position_command += " moves";
+		for (const auto move : m_game.moves)
+			position_command += ' ' + move.ToString();
+		m_cluster->Start(position_command, m_position, limits, output_format);
+	}
+	else
+		m_search->Start(m_position, limits, output_format);
+}
+
+void Engine::Stop()
+{
+	m_search->Stop();
+	m_cluster->Stop();
+	// 后台有任务时搜索线程可能正在重建，由任务自己等搜索结束，这里不等，免得卡住命令线程
+	// 任务只会由这个线程提交，检查完以后不会有新的任务开始
+	if (m_tasks->Idle())
+	{
+		m_search->Wait();
+		m_cluster->Wait();
+	}
+}
+
+void Engine::StopAndWait()
+{
+	m_search->Stop();
+	m_cluster->Stop();
+	m_tasks->Wait();
+	m_search->Wait();
+	m_cluster->Wait();
+}
+
+void Engine::PostOptionTask(std::function<void()> task)
+{
+	// 停止搜索只是发个信号，等搜索结束和真正的工作都在后台做
+	m_search->Stop();
+	m_cluster->Stop();
+	m_tasks->Post([this, task = std::move(task)] {
+		m_search->Wait();
+		task();
+		});
+}
+
+void Engine::WaitForPendingWork()
+{
+	m_tasks->Wait();
+}
+
+void Engine::UpdateCluster()
+{
+	m_cluster_dirty = false;
+	if (m_cluster->SetWorkers(m_cluster_workers, m_cluster_command, m_search->ThreadCount(), m_tt->SizeMB()))
+	{
+		if (m_cluster_workers > 0)
+			m_output->WriteNow("info string cluster started " + std::to_string(m_cluster_workers) + " workers");
+	}
+	else
+		m_output->WriteNow("info string cluster failed to start workers, searching locally");
+}
+
+std::string Engine::SaveHash(const std::string& path)
+{
+	StopAndWait();
+	std::string error;
+	if (!m_tt->Save(path, m_hash_direct_io, error))
+		return "info string savehash failed: " + error;
+	return "info string saved " + std::to_string(m_tt->SizeMB()) + " MB hash to " + path;
+}
+
+std::string Engine::LoadHash(const std::string& path)
+{
+	// 共用的置换表别的会话还在用
+	if (m_shared_tt)
+		return "info string loadhash failed: hash is shared with other sessions";
+	StopAndWait();
+	std::string error;
+	if (!m_tt->Load(path, m_hash_direct_io, error))
+		return "info string loadhash failed: " + error;
+	return "info string loaded " + std::to_string(m_tt->SizeMB()) + " MB hash from " + path;
+}
+
+std::string Engine::ExportHash(int max_plies)
+{
+	m_tasks->Wait();
+	std::string res;
+	for (const auto& entry : CollectTTEntries(m_position, *m_tt, max_plies))
+	{
+		if (!res.empty())
+			res += '\n';
+		res += "hashentry " + FormatTTEntry(entry);
+	}
+	return res;
+}
+
+bool Engine::ImportHash(std::span<const std::string_view> entry)
+{
+	m_tasks->Wait();
+	const auto parsed = ParseTTEntry(entry);
+	if (parsed.has_value())
+		StoreTTEntry(*m_tt, *parsed);
+	return parsed.has_value();
+}
+
+std::string Engine::AnalyzeGame(const GameAnalysisConfig& config)
+{
+	StopAndWait();
+	const auto analysis = Carp::AnalyzeGame(*m_search, m_game, config);
+	if (!analysis)
+		return "info string analyzegame failed";
+	return FormatGameAnalysis(*analysis, "info string analyzegame ");
+}
+
+std::string Engine::RunTactics(const std::string& path, const SearchLimits& limits, const OutputSearch& output_format)
+{
+	StopAndWait();
+	std::ifstream in{ path };
+	if (!in)
+		return "info string tactics cannot open " + path;
+	const auto results = Carp::RunTactics(*m_search, ReadTactics(in), limits, output_format);
+	return FormatTacticsResults(results, "info string tactics ");
+}
+
+std::string Engine::GetStatsReport() const
+{
+	m_tasks->Wait();
+	return m_search->GetStatsReport();
+}
+
+void Engine::ResetStats()
+{
+	m_tasks->Wait();
+	m_search->ResetStats();
 }
 
 } // namespace Carp
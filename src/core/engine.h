@@ -2,7 +2,15 @@
 
 #include <string_view>
 #include <array>
+#include <functional>
 #include <algorithm>
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "game_analysis.h"
+#include "position.h"
 
 namespace Carp
 {
@@ -37,10 +45,11 @@ consteval auto GetCompileTime()
 template <std::size_t E_SIZE, std::size_t T_SIZE, std::size_t N>
 consteval auto ConcatEngineNameWithBuildTime(std::string_view engine_name, std::string_view build_time, const char(&link)[N])
 {
-    std::array<char, E_SIZE + T_SIZE + N> res{};
+    // link末尾的'\0'不要
+    std::array<char, E_SIZE + T_SIZE + N - 1> res{};
     std::copy(engine_name.begin(), engine_name.end(), res.begin());
-    std::copy(std::begin(link), std::end(link), res.begin() + E_SIZE);
-    std::copy(build_time.begin(), build_time.end(), res.begin() + E_SIZE + N);
+    std::copy(std::begin(link), std::end(link) - 1, res.begin() + E_SIZE);
+    std::copy(build_time.begin(), build_time.end(), res.begin() + E_SIZE + N - 1);
     return res;
 }
 
@@ -56,21 +65,96 @@ constexpr std::string_view ENGINE_NAME_WITH_BUILD_TIME = std::string_view{_ENGIN
 } // namespace detail
 
 class OptionContainer;
+class AsyncOutput;
+class Search;
+class TranspositionTable;
+class ThreadBudget;
+class ClusterSearch;
+class TaskRunner;
+class EvalHash;
+class OutputSearch;
+struct SearchLimits;
+
+// 服务器模式下所有会话共用的资源，单独运行时都是空的
+struct SharedResources
+{
+	std::shared_ptr<TranspositionTable> tt;
+	ThreadBudget* thread_budget = nullptr;
+};
 
 class Engine
 {
 public:
-	Engine() = default;
-	~Engine() = default;
+	Engine();
+	// 输出写到os，共用置换表（服务器模式）时不提供Hash、Clear Hash、Deterministic和分布式搜索的选项，免得影响其它会话
+	Engine(std::ostream& os, const SharedResources& shared);
+	~Engine();
 	Engine(const Engine&) = delete;
 	Engine(Engine&&) = delete;
 	Engine& operator=(const Engine&) = delete;
 	Engine& operator=(Engine&&) = delete;
 
-	void InitOptions(OptionContainer& container) const;
+	void InitOptions(OptionContainer& container);
+
+	AsyncOutput& GetOutput() noexcept { return *m_output; }
+
+	// 设置局面，走法用ICCS坐标，有不合法的走法时返回false，原来的局面不变
+	bool SetPosition(std::string_view fen, std::span<const std::string_view> moves);
+	Position& GetPosition() noexcept { return m_position; }
+
+	// 从当前局面开始搜索，会先停掉正在进行的搜索，输出的格式由协议决定
+	void Go(const SearchLimits& limits, const OutputSearch& output_format);
+	// 只是让搜索停下来，后台还有选项没应用完时不等搜索结束
+	void Stop();
+	// 等待后台正在应用的选项（Hash、Threads之类的）全部完成，isready在回复之前调用
+	void WaitForPendingWork();
+
+	// 置换表存盘和读盘，会先停掉搜索，返回给界面看的一行info string
+	std::string SaveHash(const std::string& path);
+	std::string LoadHash(const std::string& path);
+
+	// 分布式搜索时工作进程之间交换置换表项：导出当前局面下主要变例上的项，每项一行hashentry
+	std::string ExportHash(int max_plies);
+	// entry是hashimport后面的各个字段，格式不对返回false
+	bool ImportHash(std::span<const std::string_view> entry);
+
+	// 从当前局面往前分析position命令给出的每一步，会先停掉搜索，返回每步一行的info string
+	std::string AnalyzeGame(const GameAnalysisConfig& config);
+	// 逐题搜索EPD文件里的战术题，会先停掉搜索，返回每题解出的时间和汇总的info string
+	std::string RunTactics(const std::string& path, const SearchLimits& limits, const OutputSearch& output_format);
+
+	// 各线程搜索统计的汇总
+	std::string GetStatsReport() const;
+	void ResetStats();
 
 	consteval static std::string_view GetEngineName() noexcept { return detail::ENGINE_NAME_WITH_BUILD_TIME; }
 	consteval static std::string_view GetAuthorName() noexcept { return detail::AUTHOR_NAME; }
+
+private:
+	const std::unique_ptr<AsyncOutput> m_output;
+	const std::shared_ptr<TranspositionTable> m_tt;
+	const bool m_shared_tt;
+	bool m_hash_direct_io = false;
+	// 设置了Hash Autoload以后，在下一次搜索之前读入，这时Hash选项已经设置好了
+	std::string m_hash_autoload;
+	Position m_position;
+	// position命令给出的开始局面和走法，分布式搜索时转发给工作进程，分析整盘棋时也要用
+	GameRecord m_game;
+	const std::unique_ptr<EvalHash> m_eval_hash;
+	const std::unique_ptr<Search> m_search;
+	const std::unique_ptr<ClusterSearch> m_cluster;
+	// 分布式搜索的设置改了以后，在下一次搜索之前重新启动工作进程
+	std::size_t m_cluster_workers = 0;
+	std::string m_cluster_command;
+	bool m_cluster_dirty = false;
+	// 耗时的选项在这里执行，放在最后，析构时先把剩下的任务做完
+	const std::unique_ptr<TaskRunner> m_tasks;
+
+	void UpdateCluster();
+	// 停止搜索，并且等后台任务和搜索都结束，之后可以随便用m_search和m_tt
+	void StopAndWait();
+	// 选项的耗时工作放到后台，执行前先等搜索停下来
+	void PostOptionTask(std::function<void()> task);
 };
 
 } // namespace Carp
@@ -0,0 +1,34 @@
+#include "eval_hash.h"
+#include <bit>
+#include <new>
+
+namespace Carp
+{
+
+bool EvalHash::Resize(std::size_t mb)
+{
+	if (mb == 0)
+	{
+		m_table.reset();
+		m_mask = 0;
+		return true;
+	}
+	const std::size_t count = std::bit_floor(mb * 1024 * 1024 / sizeof(std::uint64_t));
+	std::unique_ptr<std::atomic<std::uint64_t>[]> table{ new (std::nothrow) std::atomic<std::uint64_t>[count] };
+	if (table == nullptr)
+		return false;
+
+	m_table = std::move(table);
+	m_mask = count - 1;
+	Clear();
+	return true;
+}
+
+void EvalHash::Clear() noexcept
+{
+	// 空项是0，只有key的高48位全是0的局面会误命中，可以忽略
+	for (std::size_t i = 0; m_table != nullptr && i <= m_mask; i++)
+		m_table[i].store(0, std::memory_order_relaxed);
+}
+
+} // namespace Carp
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "def.h"
+
+namespace Carp
+{
+
+// 静态评估的缓存，多线程共享，不加锁
+// 每项是一个64位整数，高48位是局面key，低16位是评估值，读写都只有一次原子操作，不会读到一半新一半旧的项
+class EvalHash
+{
+public:
+	EvalHash() = default;
+	EvalHash(const EvalHash&) = delete;
+	EvalHash& operator=(const EvalHash&) = delete;
+
+	// 单位是MB，项数向下取到2的幂，0表示不用缓存，分配失败时保留原来的表并返回false
+	bool Resize(std::size_t mb);
+	void Clear() noexcept;
+	bool Enabled() const noexcept { return m_table != nullptr; }
+
+	// 以下几个函数只能在Enabled时调用
+
+	bool Probe(std::uint64_t key, Value& value) const noexcept
+	{
+		const auto data = Slot(key).load(std::memory_order_relaxed);
+		if ((data ^ key) & KEY_MASK)
+			return false;
+		value = static_cast<std::int16_t>(data & VALUE_MASK);
+		return true;
+	}
+
+	void Store(std::uint64_t key, Value value) noexcept
+	{
+		Slot(key).store((key & KEY_MASK) | (static_cast<std::uint16_t>(value) & VALUE_MASK), std::memory_order_relaxed);
+	}
+
+	void Prefetch(std::uint64_t key) const noexcept
+	{
+#if defined(__GNUC__)
+		__builtin_prefetch(&Slot(key));
+#endif
+	}
+
+private:
+	static constexpr std::uint64_t VALUE_MASK = 0xffff;
+	static constexpr std::uint64_t KEY_MASK = ~VALUE_MASK;
+
+	std::unique_ptr<std::atomic<std::uint64_t>[]> m_table;
+	// 项数减1
+	std::size_t m_mask = 0;
+
+	std::atomic<std::uint64_t>& Slot(std::uint64_t key) const noexcept { return m_table[key & m_mask]; }
+};
+
+} // namespace Carp
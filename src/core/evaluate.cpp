@@ -0,0 +1,60 @@
+#include "evaluate.h"
+#include <cstdlib>
+#include "position.h"
+#include "utils/cpu.h"
+
+namespace Carp
+{
+
+constexpr Value TEMPO = 10;
+
+// 从己方的角度看的行，己方底线是0
+static int RelativeRank(PlayerType player, Square sq) noexcept
+{
+	return player == PlayerType::Red ? GetRank(sq) : BOARD_RANK_NB - 1 - GetRank(sq);
+}
+
+// 子力位置的加分，只考虑兵、马、炮的几个简单特征
+static Value PieceSquareValue(PlayerType player, PieceType piece, Square sq) noexcept
+{
+	const int rank = RelativeRank(player, sq);
+	const int file_dist = std::abs(GetFile(sq) - BOARD_FILE_NB / 2);
+	switch (piece)
+	{
+	case PieceType::Pawn:
+		// 过河兵价值翻倍，越靠近九宫越好，沉底兵就没什么用了
+		if (rank < 5)
+			return 0;
+		if (rank == BOARD_RANK_NB - 1)
+			return 20;
+		return 80 + (rank >= 6 && rank <= 8 && file_dist <= 2 ? 40 - 10 * file_dist : 0);
+	case PieceType::Knight:
+		return 20 - 6 * file_dist + (rank >= 4 && rank <= 7 ? 20 : 0);
+	case PieceType::Cannon:
+		return file_dist == 0 ? 20 : 0;
+	case PieceType::Rook:
+		return rank >= 5 ? 20 : 0;
+	default:
+		return 0;
+	}
+}
+
+CARP_CPU_DISPATCH Value Evaluate(const Position& pos) noexcept
+{
+	std::array<Value, PLAYER_NB> scores{};
+	for (auto player : { PlayerType::Red, PlayerType::Black })
+	{
+		auto& score = scores[PlayerIndex(player)];
+		for (int i = 0; i < PIECE_TYPE_NB; i++)
+		{
+			const auto piece = static_cast<PieceType>(i);
+			for (Bitboard bb = pos.Pieces(player, piece); bb; )
+				score += PieceValue(piece) + PieceSquareValue(player, piece, bb.PopLsb());
+		}
+	}
+
+	const auto us = pos.SideToMove();
+	return scores[PlayerIndex(us)] - scores[PlayerIndex(Opponent(us))] + TEMPO;
+}
+
+} // namespace Carp
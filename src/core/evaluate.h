@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include "def.h"
+
+namespace Carp
+{
+
+class Position;
+
+// 按PieceType的顺序：帅、士、象、马、车、炮、兵
+constexpr std::array<Value, PIECE_TYPE_NB> PIECE_VALUE = { 0, 200, 200, 400, 900, 450, 100 };
+
+constexpr Value PieceValue(PieceType piece) noexcept
+{
+	return PIECE_VALUE[static_cast<std::size_t>(piece)];
+}
+
+// 静态评估，从走子方的角度
+Value Evaluate(const Position& pos) noexcept;
+
+} // namespace Carp
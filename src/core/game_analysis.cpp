@@ -0,0 +1,267 @@
+#include "game_analysis.h"
+#include <cctype>
+#include <chrono>
+#include <sstream>
+#include "movegen.h"
+#include "position.h"
+#include "search.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+std::string_view Trim(std::string_view str) noexcept
+{
+	const auto begin = str.find_first_not_of(" \t\r\n");
+	if (begin == std::string_view::npos)
+		return {};
+	return str.substr(begin, str.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// PGN里的ICCS走法可能是H2-E2、h2e2或者和回合数连在一起的1.H2-E2
+std::optional<Move> ParsePgnMove(std::string_view token)
+{
+	const auto dot = token.find_last_of('.');
+	if (dot != std::string_view::npos)
+		token.remove_prefix(dot + 1);
+	std::string iccs;
+	for (char c : token)
+	{
+		if (c != '-')
+			iccs += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+	if (iccs.empty())
+		return Move{};
+	const auto move = Move::FromString(iccs);
+	if (!move)
+		return std::nullopt;
+	return move;
+}
+
+bool IsResult(std::string_view token) noexcept
+{
+	return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+// [Name "Value"]
+std::pair<std::string_view, std::string_view> ParseTag(std::string_view line) noexcept
+{
+	line = Trim(line.substr(1, line.find(']') == std::string_view::npos ? line.size() - 1 : line.find(']') - 1));
+	const auto space = line.find(' ');
+	if (space == std::string_view::npos)
+		return { line, {} };
+	auto value = Trim(line.substr(space + 1));
+	if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+		value = value.substr(1, value.size() - 2);
+	return { line.substr(0, space), value };
+}
+
+// position命令的格式："[position] startpos|fen <FEN> [moves ...]"
+GameRecord ParsePositionLine(std::string_view line)
+{
+	GameRecord game;
+	std::istringstream ss{ std::string{ line } };
+	std::string token;
+	ss >> token;
+	if (token == "position")
+		ss >> token;
+	if (token == "startpos")
+	{
+		game.fen = START_FEN;
+		ss >> token;
+	}
+	else
+	{
+		while (ss >> token && token != "moves")
+		{
+			if (!game.fen.empty())
+				game.fen += ' ';
+			game.fen += token;
+		}
+	}
+	if (token != "moves")
+		return game;
+	while (ss >> token)
+	{
+		const auto move = Move::FromString(token);
+		if (!move)
+		{
+			game.error = "invalid move " + token;
+			break;
+		}
+		game.moves.push_back(move);
+	}
+	return game;
+}
+
+} // namespace
+
+std::optional<GameAnalysis> AnalyzeGame(Search& search, const GameRecord& game, const GameAnalysisConfig& config)
+{
+	Position pos;
+	if (!game.error.empty() || !pos.SetFen(game.fen))
+		return std::nullopt;
+	for (const auto move : game.moves)
+	{
+		if (!pos.CanMakeMove() || !IsLegalMove(pos, move))
+			return std::nullopt;
+		pos.MakeMove(move);
+	}
+
+	SearchLimits limits;
+	limits.depth = config.depth;
+	limits.move_time = config.move_time;
+	const auto start = std::chrono::steady_clock::now();
+
+	// 先搜最后的局面，分数是下一步的played_score
+	GameAnalysis analysis;
+	analysis.moves.resize(game.moves.size());
+	auto result = search.SearchNow(pos, limits);
+	analysis.nodes += result.nodes;
+	for (std::size_t i = game.moves.size(); i-- > 0; )
+	{
+		const auto next_score = result.score;
+		pos.UnmakeMove();
+		result = search.SearchNow(pos, limits);
+		analysis.nodes += result.nodes;
+
+		auto& entry = analysis.moves[i];
+		entry.played = game.moves[i];
+		entry.best = result.best;
+		entry.best_score = result.score;
+		// 走的就是最好的走法时两次搜索的差别只是误差，不算损失
+		entry.played_score = entry.played == entry.best ? result.score : static_cast<Value>(-next_score);
+		entry.blunder = entry.best_score - entry.played_score >= config.blunder_threshold;
+	}
+	analysis.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	return analysis;
+}
+
+std::string FormatGameAnalysis(const GameAnalysis& analysis, std::string_view prefix)
+{
+	std::ostringstream ss;
+	std::size_t blunders = 0;
+	for (std::size_t i = 0; i < analysis.moves.size(); i++)
+	{
+		const auto& entry = analysis.moves[i];
+		ss << prefix << "ply " << i + 1 << " move " << entry.played.ToString()
+			<< " best " << (entry.best ? entry.best.ToString() : "(none)")
+			<< " score " << entry.best_score << " played " << entry.played_score;
+		if (entry.blunder)
+		{
+			ss << " blunder";
+			blunders++;
+		}
+		ss << '\n';
+	}
+	ss << prefix << "moves " << analysis.moves.size() << " blunders " << blunders
+		<< " nodes " << analysis.nodes << " time " << analysis.time;
+	return ss.str();
+}
+
+std::vector<GameRecord> ReadGames(std::istream& in)
+{
+	std::vector<GameRecord> games;
+	GameRecord pgn;
+	std::string red;
+	std::string black;
+	// 当前的PGN对局已经有内容了，再遇到标签就是下一盘
+	bool in_movetext = false;
+	bool has_pgn = false;
+	int comment_depth = 0;
+
+	auto finish_pgn = [&]() {
+		if (has_pgn)
+		{
+			if (pgn.fen.empty())
+				pgn.fen = START_FEN;
+			if (!red.empty() || !black.empty())
+				pgn.name = red + " vs " + black;
+			games.push_back(std::move(pgn));
+		}
+		pgn = GameRecord{};
+		red.clear();
+		black.clear();
+		in_movetext = false;
+		has_pgn = false;
+	};
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		const auto trimmed = Trim(line);
+		if (comment_depth == 0)
+		{
+			if (trimmed.empty())
+				continue;
+			if (trimmed.starts_with("position ") || trimmed.starts_with("startpos") || trimmed.starts_with("fen "))
+			{
+				finish_pgn();
+				games.push_back(ParsePositionLine(trimmed));
+				continue;
+			}
+			if (trimmed.front() == '[')
+			{
+				if (in_movetext)
+					finish_pgn();
+				has_pgn = true;
+				const auto [name, value] = ParseTag(trimmed);
+				if (name == "FEN")
+					pgn.fen = value;
+				else if (name == "Red")
+					red = value;
+				else if (name == "Black")
+					black = value;
+				continue;
+			}
+		}
+
+		// 走法部分，跳过注释{...}、变着(...)和;到行尾的注释
+		std::string token;
+		auto flush_token = [&]() {
+			if (token.empty())
+				return;
+			if (IsResult(token))
+			{
+				finish_pgn();
+			}
+			else if (pgn.error.empty())
+			{
+				has_pgn = true;
+				in_movetext = true;
+				const auto move = ParsePgnMove(token);
+				if (!move)
+					pgn.error = "unsupported move " + token;
+				else if (*move)
+					pgn.moves.push_back(*move);
+			}
+			token.clear();
+		};
+		for (char c : trimmed)
+		{
+			if (c == '{' || c == '(')
+			{
+				flush_token();
+				comment_depth++;
+			}
+			else if (c == '}' || c == ')')
+				comment_depth = std::max(comment_depth - 1, 0);
+			else if (comment_depth > 0)
+				continue;
+			else if (c == ';')
+				break;
+			else if (std::isspace(static_cast<unsigned char>(c)))
+				flush_token();
+			else
+				token += c;
+		}
+		if (comment_depth == 0)
+			flush_token();
+	}
+	finish_pgn();
+	return games;
+}
+
+} // namespace Carp
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+#include <vector>
+#include "def.h"
+#include "move.h"
+
+namespace Carp
+{
+
+class Search;
+
+// 一盘棋：开始的局面和之后的走法
+struct GameRecord
+{
+	std::string fen;
+	std::vector<Move> moves;
+	// PGN里的对局双方，没有的话是空的
+	std::string name;
+	// 读棋谱时出错的原因，比如走法不是ICCS坐标，出错的对局不分析
+	std::string error;
+};
+
+struct GameAnalysisConfig
+{
+	// 每个局面的搜索深度，给了move_time时按时间
+	int depth = 10;
+	std::optional<std::int64_t> move_time;
+	// 实际走法比最好的走法差这么多就算败着
+	Value blunder_threshold = 150;
+};
+
+// 一步棋的分析结果，分数都是走这步棋的一方的角度
+struct MoveAnalysis
+{
+	Move played;
+	Move best;
+	Value best_score;
+	// 走完这步以后的局面的分数
+	Value played_score;
+	bool blunder;
+};
+
+struct GameAnalysis
+{
+	std::vector<MoveAnalysis> moves;
+	std::uint64_t nodes = 0;
+	std::int64_t time = 0;
+};
+
+// 从最后一个局面开始往前逐个搜索，置换表和历史表一直保留，
+// 前面的局面搜索时可以直接用上后面局面的结果，每一步都比重新开始搜索便宜得多
+// 开始局面或者走法不合法时返回nullopt
+std::optional<GameAnalysis> AnalyzeGame(Search& search, const GameRecord& game, const GameAnalysisConfig& config);
+
+// 每步一行"ply <n> move <走法> best <走法> score <分数> played <分数> [blunder]"，最后一行是汇总，每行前面加上prefix
+std::string FormatGameAnalysis(const GameAnalysis& analysis, std::string_view prefix);
+
+// 读棋谱，可以有多盘：PGN（走法是ICCS坐标，如H2-E2或者h2e2，开始局面用FEN标签），
+// 或者每行一盘"startpos|fen <FEN> [moves ...]"，和position命令的格式一样
+std::vector<GameRecord> ReadGames(std::istream& in);
+
+} // namespace Carp
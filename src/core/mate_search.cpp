@@ -0,0 +1,330 @@
+#include "mate_search.h"
+#include <algorithm>
+#include <limits>
+#include "movegen.h"
+#include "position.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+constexpr std::uint32_t PN_INFINITE = std::numeric_limits<std::uint32_t>::max();
+// 最多保存这么多节点，大约80MB
+constexpr std::size_t NODE_CAPACITY = std::size_t{ 1 } << 22;
+// 每展开这么多节点检查一次是否要停止
+constexpr std::uint64_t CHECK_INTERVAL = 1024;
+
+std::uint32_t SaturatingAdd(std::uint32_t a, std::uint32_t b) noexcept
+{
+	return a > PN_INFINITE - b ? PN_INFINITE : a + b;
+}
+
+// 搜索树的节点，偶数层是攻方走（OR节点），奇数层是守方走（AND节点）
+struct PnsNode
+{
+	std::uint32_t pn;
+	std::uint32_t dn;
+	std::uint32_t parent;
+	// 0表示还没有展开，根节点不会是别的节点的子节点
+	std::uint32_t first_child;
+	std::uint16_t child_count;
+	Move move;
+};
+
+// 不同的步数和走法范围依次用同一个对象搜索，树的空间只分配一次
+class ProofNumberSearch
+{
+public:
+	ProofNumberSearch(const Position& pos, std::span<const Move> root_moves) :
+		m_pos(pos),
+		m_root_moves(root_moves)
+	{
+		m_nodes.reserve(NODE_CAPACITY);
+	}
+
+	// 清空搜索树，开始新的一次搜索
+	void Reset(int max_ply, bool checks_only);
+	// 返回根节点是否被证明，nodes是展开的节点数，max_nodes为0时不限制
+	bool Run(std::uint64_t& nodes, std::uint64_t max_nodes, const std::function<bool(std::uint64_t)>& should_stop);
+	// 节点数用完了或者被要求停止
+	bool Stopped() const noexcept { return m_stopped; }
+	// 树放不下了，更大的搜索也不用试了
+	bool Full() const noexcept { return m_full; }
+
+	std::vector<Move> ProofLine() const;
+	// 最有希望的根节点走法
+	Move BestRootMove() const noexcept;
+
+private:
+	Position m_pos;
+	const std::span<const Move> m_root_moves;
+	int m_max_ply = 0;
+	bool m_checks_only = false;
+	std::vector<PnsNode> m_nodes;
+	bool m_stopped = false;
+	bool m_full = false;
+
+	static bool IsSolved(const PnsNode& node) noexcept { return node.pn == 0 || node.dn == 0; }
+	static bool IsOrNode(int ply) noexcept { return ply % 2 == 0; }
+
+	std::uint32_t SelectChild(std::uint32_t index, bool or_node) const noexcept;
+	void Expand(std::uint32_t index, int ply);
+	void UpdateFromChildren(std::uint32_t index, bool or_node) noexcept;
+	PnsNode MakeChild(std::uint32_t parent, Move move, int child_ply);
+	// 证明树上到杀棋还要走几层，攻方选最短的，守方选最长的
+	int ProofLength(std::uint32_t index, bool or_node) const;
+};
+
+void ProofNumberSearch::Reset(int max_ply, bool checks_only)
+{
+	m_max_ply = max_ply;
+	m_checks_only = checks_only;
+	m_stopped = false;
+	m_full = false;
+	m_nodes.clear();
+	m_nodes.push_back(PnsNode{ 1, 1, 0, 0, 0, Move{} });
+}
+
+bool ProofNumberSearch::Run(std::uint64_t& nodes, std::uint64_t max_nodes, const std::function<bool(std::uint64_t)>& should_stop)
+{
+	std::uint32_t current = 0;
+	int ply = 0;
+	while (!IsSolved(m_nodes.front()))
+	{
+		m_full = m_nodes.size() + MAX_MOVES > NODE_CAPACITY;
+		if (m_full)
+			break;
+		if ((max_nodes > 0 && nodes >= max_nodes) || (nodes % CHECK_INTERVAL == 0 && should_stop(nodes)))
+		{
+			m_stopped = true;
+			break;
+		}
+
+		// 沿着最有希望的路径走到一个没展开的节点
+		while (m_nodes[current].first_child != 0)
+		{
+			current = SelectChild(current, IsOrNode(ply));
+			m_pos.MakeMove(m_nodes[current].move);
+			ply++;
+		}
+		Expand(current, ply);
+		nodes++;
+
+		// 往上更新，值不变了就从那里接着往下选
+		while (current != 0)
+		{
+			const auto parent = m_nodes[current].parent;
+			m_pos.UnmakeMove();
+			ply--;
+			const auto old_pn = m_nodes[parent].pn;
+			const auto old_dn = m_nodes[parent].dn;
+			UpdateFromChildren(parent, IsOrNode(ply));
+			current = parent;
+			if (m_nodes[parent].pn == old_pn && m_nodes[parent].dn == old_dn)
+				break;
+		}
+	}
+	// 停下来的时候局面可能不在根节点，退回去以便下一次搜索
+	for (; ply > 0; ply--)
+		m_pos.UnmakeMove();
+	return m_nodes.front().pn == 0;
+}
+
+std::uint32_t ProofNumberSearch::SelectChild(std::uint32_t index, bool or_node) const noexcept
+{
+	const auto& node = m_nodes[index];
+	std::uint32_t best = node.first_child;
+	for (std::uint32_t i = node.first_child + 1; i < node.first_child + node.child_count; i++)
+	{
+		if (or_node ? m_nodes[i].pn < m_nodes[best].pn : m_nodes[i].dn < m_nodes[best].dn)
+			best = i;
+	}
+	return best;
+}
+
+PnsNode ProofNumberSearch::MakeChild(std::uint32_t parent, Move move, int child_ply)
+{
+	PnsNode child{ 1, 1, parent, 0, 0, move };
+	// 到了最大层数还没杀死就不算
+	const bool out_of_depth = child_ply >= m_max_ply || !m_pos.CanMakeMove();
+	// 重复局面不管是谁长将长捉，都不算杀棋
+	if (m_pos.GetRepetition() != RepetitionType::None)
+	{
+		child.pn = PN_INFINITE;
+		child.dn = 0;
+	}
+	else if (!IsOrNode(child_ply))
+	{
+		// 守方没有走法就是被杀了，困毙也一样
+		MoveList replies;
+		GenerateLegal<GenType::All>(m_pos, replies);
+		if (replies.empty())
+		{
+			child.pn = 0;
+			child.dn = PN_INFINITE;
+		}
+		else if (out_of_depth)
+		{
+			child.pn = PN_INFINITE;
+			child.dn = 0;
+		}
+		else
+			child.pn = static_cast<std::uint32_t>(replies.size());
+	}
+	else if (out_of_depth)
+	{
+		// 攻方已经没有步数了
+		child.pn = PN_INFINITE;
+		child.dn = 0;
+	}
+	return child;
+}
+
+void ProofNumberSearch::Expand(std::uint32_t index, int ply)
+{
+	const bool or_node = IsOrNode(ply);
+	MoveList list;
+	GenerateLegal<GenType::All>(m_pos, list);
+
+	const auto first = static_cast<std::uint32_t>(m_nodes.size());
+	for (const auto& [move, score] : list)
+	{
+		if (index == 0 && !m_root_moves.empty() && std::ranges::find(m_root_moves, move) == m_root_moves.end())
+			continue;
+		m_pos.MakeMove(move);
+		if (or_node && m_checks_only && !m_pos.InCheck())
+		{
+			m_pos.UnmakeMove();
+			continue;
+		}
+		const auto child = MakeChild(index, move, ply + 1);
+		m_pos.UnmakeMove();
+		m_nodes.push_back(child);
+	}
+
+	auto& node = m_nodes[index];
+	node.first_child = first;
+	node.child_count = static_cast<std::uint16_t>(m_nodes.size() - first);
+	if (node.child_count == 0)
+	{
+		// 攻方没有可走的就证伪了；守方没有走法的节点在生成时就已经证明了
+		node.first_child = 0;
+		node.pn = or_node ? PN_INFINITE : 0;
+		node.dn = or_node ? 0 : PN_INFINITE;
+		return;
+	}
+	UpdateFromChildren(index, or_node);
+}
+
+void ProofNumberSearch::UpdateFromChildren(std::uint32_t index, bool or_node) noexcept
+{
+	auto& node = m_nodes[index];
+	std::uint32_t min_value = PN_INFINITE;
+	std::uint32_t sum = 0;
+	for (std::uint32_t i = node.first_child; i < node.first_child + node.child_count; i++)
+	{
+		const auto& child = m_nodes[i];
+		min_value = std::min(min_value, or_node ? child.pn : child.dn);
+		sum = SaturatingAdd(sum, or_node ? child.dn : child.pn);
+	}
+	node.pn = or_node ? min_value : sum;
+	node.dn = or_node ? sum : min_value;
+}
+
+int ProofNumberSearch::ProofLength(std::uint32_t index, bool or_node) const
+{
+	const auto& node = m_nodes[index];
+	// 没有展开的已证明节点只能是守方被杀
+	if (node.first_child == 0)
+		return 0;
+	int length = or_node ? std::numeric_limits<int>::max() : 0;
+	for (std::uint32_t i = node.first_child; i < node.first_child + node.child_count; i++)
+	{
+		if (m_nodes[i].pn != 0)
+			continue;
+		const int child_length = 1 + ProofLength(i, !or_node);
+		length = or_node ? std::min(length, child_length) : std::max(length, child_length);
+	}
+	return length;
+}
+
+std::vector<Move> ProofNumberSearch::ProofLine() const
+{
+	std::vector<Move> line;
+	std::uint32_t index = 0;
+	bool or_node = true;
+	while (m_nodes[index].first_child != 0)
+	{
+		const auto& node = m_nodes[index];
+		std::uint32_t best = 0;
+		int best_length = or_node ? std::numeric_limits<int>::max() : -1;
+		for (std::uint32_t i = node.first_child; i < node.first_child + node.child_count; i++)
+		{
+			if (m_nodes[i].pn != 0)
+				continue;
+			const int length = ProofLength(i, !or_node);
+			if (or_node ? length < best_length : length > best_length)
+			{
+				best = i;
+				best_length = length;
+			}
+		}
+		line.push_back(m_nodes[best].move);
+		index = best;
+		or_node = !or_node;
+	}
+	return line;
+}
+
+Move ProofNumberSearch::BestRootMove() const noexcept
+{
+	const auto& root = m_nodes.front();
+	if (root.first_child == 0)
+		return Move{};
+	return m_nodes[SelectChild(0, true)].move;
+}
+
+} // namespace
+
+MateResult FindMate(const Position& pos, const MateSearchLimits& limits, const std::function<bool(std::uint64_t)>& should_stop)
+{
+	MateResult result;
+	const int max_moves = std::clamp(limits.max_moves, 1, MAX_MATE_MOVES);
+	ProofNumberSearch pns(pos, limits.root_moves);
+	// 所有走法的树放不下以后只找连将杀，这时找到的不一定是最短的
+	bool all_moves = true;
+	for (int moves = 1; moves <= max_moves; moves++)
+	{
+		// 更少步数的杀法前面已经用所有走法排除了，这一步数找到的杀法就是最短的
+		for (const bool checks_only : { true, false })
+		{
+			if (!checks_only && !all_moves)
+				break;
+			const auto remaining = limits.max_nodes > 0 ? limits.max_nodes - std::min(limits.max_nodes, result.nodes) : 0;
+			if (limits.max_nodes > 0 && remaining == 0)
+				return result;
+			pns.Reset(2 * moves - 1, checks_only);
+			std::uint64_t nodes = 0;
+			const bool proven = pns.Run(nodes, remaining, [&](std::uint64_t n) { return should_stop(result.nodes + n); });
+			result.nodes += nodes;
+			if (const auto best = pns.BestRootMove(); best && (!result.best || !checks_only))
+				result.best = best;
+			if (proven)
+			{
+				result.pv = pns.ProofLine();
+				result.moves = static_cast<int>(result.pv.size() + 1) / 2;
+				result.best = result.pv.front();
+				return result;
+			}
+			if (pns.Stopped() || (pns.Full() && checks_only))
+				return result;
+			if (pns.Full())
+				all_moves = false;
+		}
+	}
+	return result;
+}
+
+} // namespace Carp
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+#include "move.h"
+
+namespace Carp
+{
+
+class Position;
+
+// go mate最多找几步杀，再多搜索层数就超过MAX_PLY了
+constexpr int MAX_MATE_MOVES = 60;
+
+struct MateSearchLimits
+{
+	// 最多几步杀，只算己方走的步数
+	int max_moves = 1;
+	// 最多展开多少个节点，0表示只受内存限制
+	std::uint64_t max_nodes = 0;
+	// 根节点只考虑这些走法，空的话不限制
+	std::span<const Move> root_moves;
+};
+
+struct MateResult
+{
+	// 几步杀，0表示没找到
+	int moves = 0;
+	std::vector<Move> pv;
+	// 没找到杀棋时最有希望的走法，可能是空的
+	Move best;
+	std::uint64_t nodes = 0;
+};
+
+// 用证明数搜索找强制杀棋，排局里的连杀用这个比普通的搜索快得多
+// 步数从1开始逐步加大，每个步数先只考虑将军的走法（连将杀），找不到再考虑所有走法，找到的是最短的杀法
+// 困毙也算输，不将军的杀法可能比连将杀短，所以每个步数都要用所有走法排除过才加大
+// should_stop每展开一批节点调用一次，参数是已经展开的节点数，返回true就停止
+MateResult FindMate(const Position& pos, const MateSearchLimits& limits, const std::function<bool(std::uint64_t)>& should_stop);
+
+} // namespace Carp
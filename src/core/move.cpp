@@ -0,0 +1,45 @@
+#include "move.h"
+#include <algorithm>
+
+namespace Carp
+{
+
+std::string Move::ToString() const
+{
+	if (!IsValid())
+		return "0000";
+
+	const auto from = From();
+	const auto to = To();
+	return std::string{
+		static_cast<char>('a' + GetFile(from)),
+		static_cast<char>('0' + GetRank(from)),
+		static_cast<char>('a' + GetFile(to)),
+		static_cast<char>('0' + GetRank(to)),
+	};
+}
+
+Move Move::FromString(std::string_view str) noexcept
+{
+	if (str.size() != 4)
+		return Move{};
+
+	auto parse_square = [](char file, char rank) -> int {
+		if (file < 'a' || file >= 'a' + BOARD_FILE_NB || rank < '0' || rank >= '0' + BOARD_RANK_NB)
+			return -1;
+		return MakeSquare(file - 'a', rank - '0');
+	};
+
+	const int from = parse_square(str[0], str[1]);
+	const int to = parse_square(str[2], str[3]);
+	if (from < 0 || to < 0 || from == to)
+		return Move{};
+	return Move{ static_cast<Square>(from), static_cast<Square>(to) };
+}
+
+bool MoveList::Contains(Move move) const noexcept
+{
+	return std::ranges::any_of(*this, [move](const ScoredMove& scored) { return scored.move == move; });
+}
+
+} // namespace Carp
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "def.h"
+
+namespace Carp
+{
+
+// 走法只记录起点和终点，各占7位，一共16位
+// 吃子之类的标记都可以通过棋盘推出来，不存在走法里，这样置换表里存走法也更省空间
+class Move
+{
+public:
+	constexpr Move() noexcept = default;
+	constexpr Move(Square from, Square to) noexcept :
+		m_data(static_cast<std::uint16_t>(from | (to << TO_SHIFT))) {}
+
+	constexpr Square From() const noexcept { return static_cast<Square>(m_data & SQUARE_MASK); }
+	constexpr Square To() const noexcept { return static_cast<Square>((m_data >> TO_SHIFT) & SQUARE_MASK); }
+	// 起点和终点不会相同，所以0可以表示空走法
+	constexpr bool IsValid() const noexcept { return m_data != 0; }
+	constexpr explicit operator bool() const noexcept { return IsValid(); }
+
+	constexpr std::uint16_t GetRaw() const noexcept { return m_data; }
+	constexpr static Move FromRaw(std::uint16_t raw) noexcept { Move move; move.m_data = raw; return move; }
+
+	constexpr bool operator==(const Move&) const noexcept = default;
+
+	// 和ICCS坐标（如h2e2）之间的转换，解析失败返回空走法
+	std::string ToString() const;
+	static Move FromString(std::string_view str) noexcept;
+
+private:
+	static constexpr int TO_SHIFT = 7;
+	static constexpr std::uint16_t SQUARE_MASK = 0x7f;
+
+	std::uint16_t m_data = 0;
+};
+
+static_assert(sizeof(Move) == 2);
+
+// 子数和位置合法（见Position::SetFen）的局面，伪合法走法也不会超过120个左右，留一点余量
+// 子数不受限制的局面会超过这个数，所以SetFen必须拒绝多出来的子
+constexpr std::size_t MAX_MOVES = 128;
+
+struct ScoredMove
+{
+	Move move;
+	std::int32_t score;
+};
+
+// 固定容量的走法列表，直接放在栈上，不会有堆分配
+class MoveList
+{
+public:
+	MoveList() noexcept = default;
+	MoveList(const MoveList&) = delete;
+	MoveList& operator=(const MoveList&) = delete;
+
+	void Push(Move move, std::int32_t score = 0) noexcept
+	{
+		assert(m_size < MAX_MOVES);
+		// 发布版里万一超出也只是丢掉多的走法，不会写坏栈
+		if (m_size < MAX_MOVES)
+			m_moves[m_size++] = ScoredMove{ move, score };
+	}
+	void Clear() noexcept { m_size = 0; }
+	// 只能缩小
+	void Resize(std::size_t size) noexcept { m_size = size; }
+
+	std::size_t size() const noexcept { return m_size; }
+	bool empty() const noexcept { return m_size == 0; }
+
+	ScoredMove& operator[](std::size_t index) noexcept { return m_moves[index]; }
+	const ScoredMove& operator[](std::size_t index) const noexcept { return m_moves[index]; }
+
+	ScoredMove* begin() noexcept { return m_moves.data(); }
+	ScoredMove* end() noexcept { return m_moves.data() + m_size; }
+	const ScoredMove* begin() const noexcept { return m_moves.data(); }
+	const ScoredMove* end() const noexcept { return m_moves.data() + m_size; }
+
+	bool Contains(Move move) const noexcept;
+
+private:
+	std::array<ScoredMove, MAX_MOVES> m_moves;
+	std::size_t m_size = 0;
+};
+
+} // namespace Carp
@@ -0,0 +1,258 @@
+#include "movegen.h"
+#include "position.h"
+#include "attack.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+// 生成走法之前先算好哪些走法可能会让自己被将军，只有这些走法才需要真正检查
+struct KingSafety
+{
+	// 自己的子里面，挪开以后会露出攻击的：车和将帅线上唯一的阻挡、炮线上两个阻挡之一、马腿
+	Bitboard blockers;
+	// 对方的炮和己方将帅之间的空格，走进来就成了炮架
+	Bitboard screens;
+	bool in_check;
+};
+
+KingSafety ComputeKingSafety(const Position& pos) noexcept
+{
+	KingSafety safety{ Bitboard{}, Bitboard{}, pos.InCheck() };
+	const auto us = pos.SideToMove();
+	const auto them = Opponent(us);
+	const auto king_sq = pos.KingSquare(us);
+	const auto occupied = pos.Occupied();
+	const auto ours = pos.Occupied(us);
+	const auto rook_like = pos.Pieces(them, PieceType::Rook) | pos.Pieces(them, PieceType::King);
+	const auto cannons = pos.Pieces(them, PieceType::Cannon);
+
+	for (int dir = 0; dir < DIRECTION_NB; dir++)
+	{
+		// 沿着这个方向找前三个子
+		std::array<Square, 3> found{};
+		std::size_t count = 0;
+		Bitboard empty_before;
+		for (Square sq : GetRay(king_sq, dir))
+		{
+			if (!occupied.Test(sq))
+			{
+				if (count == 0)
+					empty_before |= sq;
+				continue;
+			}
+			found[count++] = sq;
+			if (count == found.size())
+				break;
+		}
+
+		if (count >= 1 && cannons.Test(found[0]))
+			safety.screens |= empty_before;
+		if (count >= 2 && rook_like.Test(found[1]) && ours.Test(found[0]))
+			safety.blockers |= found[0];
+		if (count >= 3 && cannons.Test(found[2]))
+		{
+			if (ours.Test(found[0]))
+				safety.blockers |= found[0];
+			if (ours.Test(found[1]))
+				safety.blockers |= found[1];
+		}
+	}
+
+	const auto knights = pos.Pieces(them, PieceType::Knight);
+	for (const auto& target : KnightAttackers(king_sq))
+	{
+		if (knights.Test(target.to) && ours.Test(target.block))
+			safety.blockers |= target.block;
+	}
+	return safety;
+}
+
+template <GenType T>
+class Generator
+{
+public:
+	Generator(const Position& pos, MoveList& list) noexcept :
+		m_pos(pos),
+		m_list(list),
+		m_safety(ComputeKingSafety(pos)),
+		m_us(pos.SideToMove()),
+		m_occupied(pos.Occupied()),
+		m_enemies(pos.Occupied(Opponent(m_us)))
+	{
+		if constexpr (T == GenType::All)
+			m_targets = ~pos.Occupied(m_us);
+		else if constexpr (T == GenType::Captures)
+			m_targets = m_enemies;
+		else
+			m_targets = ~m_occupied;
+	}
+
+	void Generate() noexcept
+	{
+		for (Bitboard bb = m_pos.Pieces(m_us, PieceType::Rook); bb; )
+			GenerateRook(bb.PopLsb());
+		for (Bitboard bb = m_pos.Pieces(m_us, PieceType::Cannon); bb; )
+			GenerateCannon(bb.PopLsb());
+		for (Bitboard bb = m_pos.Pieces(m_us, PieceType::Knight); bb; )
+			GenerateLeaper(bb.PopLsb(), KnightMoves);
+		for (Bitboard bb = m_pos.Pieces(m_us, PieceType::Pawn); bb; )
+		{
+			const auto from = bb.PopLsb();
+			GenerateTargets(from, PawnMoves(m_us, from));
+		}
+		for (Bitboard bb = m_pos.Pieces(m_us, PieceType::Elephant); bb; )
+			GenerateLeaper(bb.PopLsb(), ElephantMoves);
+		for (Bitboard bb = m_pos.Pieces(m_us, PieceType::Advisor); bb; )
+		{
+			const auto from = bb.PopLsb();
+			GenerateTargets(from, AdvisorMoves(from));
+		}
+		const auto king_sq = m_pos.KingSquare(m_us);
+		for (Bitboard bb = KingMoves(king_sq) & m_targets; bb; )
+		{
+			const Move move{ king_sq, bb.PopLsb() };
+			if (m_pos.IsSafeAfter(move))
+				m_list.Push(move);
+		}
+	}
+
+private:
+	const Position& m_pos;
+	MoveList& m_list;
+	const KingSafety m_safety;
+	const PlayerType m_us;
+	const Bitboard m_occupied;
+	const Bitboard m_enemies;
+	Bitboard m_targets;
+
+	void Add(Square from, Square to) noexcept
+	{
+		const Move move{ from, to };
+		// 大部分走法不需要检查，只有被将军、挪动阻挡或者走进炮线的才要检查
+		if ((m_safety.in_check || m_safety.blockers.Test(from) || m_safety.screens.Test(to)) && !m_pos.IsSafeAfter(move))
+			return;
+		m_list.Push(move);
+	}
+
+	void GenerateTargets(Square from, Bitboard targets) noexcept
+	{
+		for (Bitboard bb = targets & m_targets; bb; )
+			Add(from, bb.PopLsb());
+	}
+
+	template <typename F>
+	void GenerateLeaper(Square from, F&& get_targets) noexcept
+	{
+		for (const auto& target : get_targets(from))
+		{
+			if (!m_occupied.Test(target.block) && m_targets.Test(target.to))
+				Add(from, target.to);
+		}
+	}
+
+	void GenerateRook(Square from) noexcept
+	{
+		for (int dir = 0; dir < DIRECTION_NB; dir++)
+		{
+			for (Square to : GetRay(from, dir))
+			{
+				if (!m_occupied.Test(to))
+				{
+					if constexpr (T != GenType::Captures)
+						Add(from, to);
+					continue;
+				}
+				if constexpr (T != GenType::Quiets)
+				{
+					if (m_enemies.Test(to))
+						Add(from, to);
+				}
+				break;
+			}
+		}
+	}
+
+	void GenerateCannon(Square from) noexcept
+	{
+		for (int dir = 0; dir < DIRECTION_NB; dir++)
+		{
+			bool screen = false;
+			for (Square to : GetRay(from, dir))
+			{
+				if (!m_occupied.Test(to))
+				{
+					if constexpr (T != GenType::Captures)
+					{
+						if (!screen)
+							Add(from, to);
+					}
+					continue;
+				}
+				if (!screen)
+				{
+					screen = true;
+					continue;
+				}
+				if constexpr (T != GenType::Quiets)
+				{
+					if (m_enemies.Test(to))
+						Add(from, to);
+				}
+				break;
+			}
+		}
+	}
+};
+
+} // namespace
+
+template <GenType T>
+void GenerateLegal(const Position& pos, MoveList& list) noexcept
+{
+	Generator<T>{ pos, list }.Generate();
+}
+
+template void GenerateLegal<GenType::All>(const Position&, MoveList&) noexcept;
+template void GenerateLegal<GenType::Captures>(const Position&, MoveList&) noexcept;
+template void GenerateLegal<GenType::Quiets>(const Position&, MoveList&) noexcept;
+
+bool IsLegalMove(const Position& pos, Move move) noexcept
+{
+	if (!move)
+		return false;
+	const auto from = move.From();
+	const auto to = move.To();
+	const auto us = pos.SideToMove();
+	if (from >= SQUARE_NB || to >= SQUARE_NB || !pos.Occupied(us).Test(from) || pos.Occupied(us).Test(to))
+		return false;
+
+	// 不生成全部走法，只按棋子类型检查这一步能不能走到
+	const auto occupied = pos.Occupied();
+	auto leap = [&](const auto& targets) {
+		for (const auto& target : targets)
+		{
+			if (target.to == to)
+				return !occupied.Test(target.block);
+		}
+		return false;
+	};
+	bool reachable = false;
+	switch (DeComposePlayerPiece(pos.PieceOn(from)).second)
+	{
+	case PieceType::King: reachable = KingMoves(from).Test(to); break;
+	case PieceType::Advisor: reachable = AdvisorMoves(from).Test(to); break;
+	case PieceType::Elephant: reachable = leap(ElephantMoves(from)); break;
+	case PieceType::Knight: reachable = leap(KnightMoves(from)); break;
+	case PieceType::Rook: reachable = RookAttacks(from, occupied).Test(to); break;
+	case PieceType::Cannon:
+		reachable = pos.IsEmpty(to) ? RookAttacks(from, occupied).Test(to) : CannonAttacks(from, occupied).Test(to);
+		break;
+	case PieceType::Pawn: reachable = PawnMoves(us, from).Test(to); break;
+	}
+	return reachable && pos.IsSafeAfter(move);
+}
+
+} // namespace Carp
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "move.h"
+
+namespace Carp
+{
+
+class Position;
+
+enum class GenType
+{
+	All,
+	Captures,
+	Quiets,
+};
+
+// 只生成合法走法，走完之后自己的将帅不会被攻击，也不会和对方将帅照面
+template <GenType T>
+void GenerateLegal(const Position& pos, MoveList& list) noexcept;
+
+// 检查任意一步（比如置换表和杀手走法）在当前局面是否合法，不会生成全部走法
+bool IsLegalMove(const Position& pos, Move move) noexcept;
+
+} // namespace Carp
@@ -0,0 +1,166 @@
+#include "movepick.h"
+#include <utility>
+#include "position.h"
+#include "movegen.h"
+#include "evaluate.h"
+#include "see.h"
+
+namespace Carp
+{
+
+MovePicker::MovePicker(const Position& pos, Move best_move, const std::array<Move, 2>& killers,
+	const ButterflyHistory& main_history, const std::array<const PieceToHistory*, 2>& cont_history,
+	SearchStats& stats) noexcept :
+	m_pos(pos),
+	m_stats(stats),
+	m_best_move(best_move),
+	m_killers(killers),
+	m_main_history(&main_history),
+	m_cont_history(cont_history),
+	m_stage(best_move ? Stage::BestMove : Stage::GenCaptures) {}
+
+MovePicker::MovePicker(const Position& pos, SearchStats& stats) noexcept :
+	m_pos(pos),
+	m_stats(stats),
+	m_stage(pos.InCheck() ? Stage::QGenEvasions : Stage::QGenCaptures) {}
+
+void MovePicker::ScoreCaptures() noexcept
+{
+	// 最有价值的受害者，最没价值的攻击者
+	for (auto& [move, score] : m_moves)
+	{
+		const auto victim = m_pos.PieceOn(move.To());
+		const auto attacker = m_pos.PieceOn(move.From());
+		score = victim == PlayerPieceType::None ? 0 :
+			PieceValue(DeComposePlayerPiece(victim).second) * 8 - PieceValue(DeComposePlayerPiece(attacker).second);
+	}
+}
+
+void MovePicker::ScoreQuiets() noexcept
+{
+	for (auto i = m_current; i < m_moves.size(); i++)
+	{
+		auto& [move, score] = m_moves[i];
+		const auto piece = PieceIndex(m_pos.PieceOn(move.From()));
+		const auto to = move.To();
+		score = (*m_main_history)[piece][to] + (*m_cont_history[0])[piece][to] + (*m_cont_history[1])[piece][to];
+	}
+}
+
+Move MovePicker::PickBest() noexcept
+{
+	auto best = m_current;
+	for (auto i = m_current + 1; i < m_moves.size(); i++)
+	{
+		if (m_moves[i].score > m_moves[best].score)
+			best = i;
+	}
+	std::swap(m_moves[m_current], m_moves[best]);
+	return m_moves[m_current++].move;
+}
+
+Move MovePicker::Next() noexcept
+{
+	while (true)
+	{
+		switch (m_stage)
+		{
+		case Stage::BestMove:
+			m_stage = Stage::GenCaptures;
+			return m_best_move;
+
+		case Stage::GenCaptures:
+		{
+			CARP_STATS_INC(m_stats, movegen_calls);
+			CARP_STATS_TIMER(m_stats, movegen_ns);
+			GenerateLegal<GenType::Captures>(m_pos, m_moves);
+			ScoreCaptures();
+			m_current = m_bad_end = 0;
+			m_stage = Stage::GoodCaptures;
+			break;
+		}
+
+		case Stage::GoodCaptures:
+			while (m_current < m_moves.size())
+			{
+				const auto move = PickBest();
+				if (move == m_best_move)
+					continue;
+				if (SeeGe(m_pos, move, 0))
+					return move;
+				std::swap(m_moves[m_bad_end++], m_moves[m_current - 1]);
+			}
+			m_current = 0;
+			m_stage = Stage::Killers;
+			break;
+
+		case Stage::Killers:
+			// 杀手走法来自别的局面，要确认是合法的不吃子走法
+			while (m_current < m_killers.size())
+			{
+				const auto move = m_killers[m_current++];
+				if (move && move != m_best_move && m_pos.IsEmpty(move.To()) && IsLegalMove(m_pos, move))
+					return move;
+			}
+			m_stage = Stage::GenQuiets;
+			break;
+
+		case Stage::GenQuiets:
+		{
+			// 坏的吃子留在列表的前面，不吃子的走法接在后面
+			m_moves.Resize(m_bad_end);
+			m_current = m_bad_end;
+			CARP_STATS_INC(m_stats, movegen_calls);
+			CARP_STATS_TIMER(m_stats, movegen_ns);
+			GenerateLegal<GenType::Quiets>(m_pos, m_moves);
+			ScoreQuiets();
+			m_stage = Stage::Quiets;
+			break;
+		}
+
+		case Stage::Quiets:
+			while (m_current < m_moves.size())
+			{
+				const auto move = PickBest();
+				if (!IsSpecial(move))
+					return move;
+			}
+			m_current = 0;
+			m_stage = Stage::BadCaptures;
+			break;
+
+		case Stage::BadCaptures:
+			if (m_current < m_bad_end)
+				return m_moves[m_current++].move;
+			m_stage = Stage::End;
+			break;
+
+		case Stage::QGenCaptures:
+		case Stage::QGenEvasions:
+		{
+			CARP_STATS_INC(m_stats, movegen_calls);
+			CARP_STATS_TIMER(m_stats, movegen_ns);
+			if (m_stage == Stage::QGenCaptures)
+				GenerateLegal<GenType::Captures>(m_pos, m_moves);
+			else
+				GenerateLegal<GenType::All>(m_pos, m_moves);
+			ScoreCaptures();
+			m_current = 0;
+			m_stage = m_stage == Stage::QGenCaptures ? Stage::QCaptures : Stage::QEvasions;
+			break;
+		}
+
+		case Stage::QCaptures:
+		case Stage::QEvasions:
+			if (m_current < m_moves.size())
+				return PickBest();
+			m_stage = Stage::End;
+			break;
+
+		case Stage::End:
+			return Move{};
+		}
+	}
+}
+
+} // namespace Carp
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include "move.h"
+#include "search_arena.h"
+#include "stats.h"
+
+namespace Carp
+{
+
+class Position;
+
+// 分阶段生成走法，吃子走法没用完之前不会生成不吃子的走法，剪枝的时候可以省掉后面的生成
+class MovePicker
+{
+public:
+	// 主搜索用，best_move（比如置换表里的走法）最先返回，需要保证是合法的
+	// 杀手走法会先检查是否合法，不吃子的走法按历史分数排序，cont_history是前一步和前两步的续着历史
+	MovePicker(const Position& pos, Move best_move, const std::array<Move, 2>& killers,
+		const ButterflyHistory& main_history, const std::array<const PieceToHistory*, 2>& cont_history,
+		SearchStats& stats) noexcept;
+	// 静态搜索用，没被将军时只返回吃子，被将军时返回所有应将的走法
+	MovePicker(const Position& pos, SearchStats& stats) noexcept;
+	MovePicker(const MovePicker&) = delete;
+	MovePicker& operator=(const MovePicker&) = delete;
+
+	// 没有走法了返回空走法
+	Move Next() noexcept;
+
+private:
+	enum class Stage : std::uint8_t
+	{
+		BestMove,
+		GenCaptures,
+		GoodCaptures,
+		Killers,
+		GenQuiets,
+		Quiets,
+		BadCaptures,
+		QGenCaptures,
+		QCaptures,
+		QGenEvasions,
+		QEvasions,
+		End,
+	};
+
+	const Position& m_pos;
+	SearchStats& m_stats;
+	Move m_best_move;
+	std::array<Move, 2> m_killers{};
+	const ButterflyHistory* m_main_history = nullptr;
+	std::array<const PieceToHistory*, 2> m_cont_history{};
+	Stage m_stage;
+	MoveList m_moves;
+	std::size_t m_current = 0;
+	// SEE为负的吃子挪到列表前面，等不吃子的走完了再用
+	std::size_t m_bad_end = 0;
+
+	void ScoreCaptures() noexcept;
+	void ScoreQuiets() noexcept;
+	bool IsSpecial(Move move) const noexcept { return move == m_best_move || move == m_killers[0] || move == m_killers[1]; }
+	// 从m_current开始选出分数最高的换到m_current的位置
+	Move PickBest() noexcept;
+};
+
+} // namespace Carp
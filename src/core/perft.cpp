@@ -0,0 +1,50 @@
+#include "perft.h"
+#include <chrono>
+#include <sstream>
+#include "position.h"
+#include "movegen.h"
+
+namespace Carp
+{
+
+std::uint64_t Perft(Position& pos, int depth) noexcept
+{
+	MoveList list;
+	GenerateLegal<GenType::All>(pos, list);
+	if (depth <= 1)
+		return depth == 1 ? list.size() : 1;
+
+	std::uint64_t nodes = 0;
+	for (const auto& [move, score] : list)
+	{
+		pos.MakeMove(move);
+		nodes += Perft(pos, depth - 1);
+		pos.UnmakeMove();
+	}
+	return nodes;
+}
+
+std::string PerftReport(Position& pos, int depth)
+{
+	const auto start = std::chrono::steady_clock::now();
+	std::ostringstream os;
+	std::uint64_t total = 0;
+
+	MoveList list;
+	GenerateLegal<GenType::All>(pos, list);
+	for (const auto& [move, score] : list)
+	{
+		pos.MakeMove(move);
+		const auto nodes = Perft(pos, depth - 1);
+		pos.UnmakeMove();
+		total += nodes;
+		os << "info string " << move.ToString() << ' ' << nodes << '\n';
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	os << "info string perft depth " << depth << " nodes " << total << " time " << elapsed
+		<< " nps " << (elapsed > 0 ? total * 1000 / elapsed : total);
+	return os.str();
+}
+
+} // namespace Carp
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Carp
+{
+
+class Position;
+
+std::uint64_t Perft(Position& pos, int depth) noexcept;
+// 跑一次perft，输出每个根节点走法的节点数以及总数、耗时和速度
+std::string PerftReport(Position& pos, int depth);
+
+} // namespace Carp
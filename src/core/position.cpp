@@ -0,0 +1,437 @@
+#include "position.h"
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include "attack.h"
+#include "utils/cpu.h"
+
+namespace Carp
+{
+
+namespace
+{
+struct ZobristKeys
+{
+	std::array<std::array<std::uint64_t, SQUARE_NB>, PLAYER_PIECE_NB> pieces;
+	std::uint64_t side;
+};
+
+// splitmix64，固定种子，保证每次运行键值都一样
+constexpr std::uint64_t NextRandom(std::uint64_t& state) noexcept
+{
+	std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+consteval ZobristKeys BuildZobristKeys()
+{
+	ZobristKeys keys{};
+	std::uint64_t state = 0x43617270; // "Carp"
+	for (auto& piece_keys : keys.pieces)
+		for (auto& key : piece_keys)
+			key = NextRandom(state);
+	keys.side = NextRandom(state);
+	return keys;
+}
+
+constexpr ZobristKeys ZOBRIST = BuildZobristKeys();
+
+constexpr std::string_view PIECE_CHARS = "KABNRCP";
+
+char PieceToChar(PlayerPieceType player_piece) noexcept
+{
+	auto [player, piece] = DeComposePlayerPiece(player_piece);
+	char c = PIECE_CHARS[static_cast<std::size_t>(piece)];
+	return player == PlayerType::Red ? c : static_cast<char>(c - 'A' + 'a');
+}
+
+std::optional<PlayerPieceType> CharToPiece(char c) noexcept
+{
+	const auto player = (c >= 'a' && c <= 'z') ? PlayerType::Black : PlayerType::Red;
+	const char upper = player == PlayerType::Black ? static_cast<char>(c - 'a' + 'A') : c;
+	// 有的软件用E表示象，用H表示马
+	switch (upper)
+	{
+	case 'K': return ComposePlayerPiece(player, PieceType::King);
+	case 'A': return ComposePlayerPiece(player, PieceType::Advisor);
+	case 'B':
+	case 'E': return ComposePlayerPiece(player, PieceType::Elephant);
+	case 'N':
+	case 'H': return ComposePlayerPiece(player, PieceType::Knight);
+	case 'R': return ComposePlayerPiece(player, PieceType::Rook);
+	case 'C': return ComposePlayerPiece(player, PieceType::Cannon);
+	case 'P': return ComposePlayerPiece(player, PieceType::Pawn);
+	default: return std::nullopt;
+	}
+}
+// 每种子最多几个，FEN里多了的话走法数会超过MoveList的容量
+constexpr std::array<int, PIECE_TYPE_NB> MAX_PIECE_COUNT = { 1, 2, 2, 2, 2, 2, 5 };
+
+// 帅、士、相只能在自己的九宫或者半边的固定格子上，兵不会在出发的那一行后面
+bool IsValidPieceSquare(PlayerPieceType player_piece, Square sq) noexcept
+{
+	const auto [player, piece] = DeComposePlayerPiece(player_piece);
+	const int file = GetFile(sq);
+	// 从自己底线数起的行数
+	const int rank = player == PlayerType::Red ? GetRank(sq) : BOARD_RANK_NB - 1 - GetRank(sq);
+	const bool in_palace = file >= 3 && file <= 5 && rank <= 2;
+	switch (piece)
+	{
+	case PieceType::King: return in_palace;
+	case PieceType::Advisor: return in_palace && (file + rank) % 2 == 1;
+	case PieceType::Elephant: return rank <= 4 && rank % 2 == 0 && file % 2 == 0 && (file + rank) % 4 == 2;
+	case PieceType::Pawn: return rank >= 3;
+	default: return true;
+	}
+}
+
+} // namespace
+
+Position::Position()
+{
+	ParseFen(START_FEN);
+}
+
+Position::Position(const Position& other) noexcept
+{
+	*this = other;
+}
+
+Position& Position::operator=(const Position& other) noexcept
+{
+	if (this == &other)
+		return *this;
+	m_board = other.m_board;
+	m_pieces = other.m_pieces;
+	m_occupied = other.m_occupied;
+	m_side = other.m_side;
+	m_ply = other.m_ply;
+	std::copy_n(other.m_states.begin(), m_ply + 1, m_states.begin());
+	return *this;
+}
+
+void Position::Clear() noexcept
+{
+	m_board.fill(PlayerPieceType::None);
+	m_pieces.fill(Bitboard{});
+	m_occupied.fill(Bitboard{});
+	m_side = PlayerType::Red;
+	m_ply = 0;
+	m_states[0] = StateInfo{ 0, 0, Bitboard{}, Move{}, PlayerPieceType::None, 0 };
+}
+
+bool Position::SetFen(std::string_view fen)
+{
+	if (ParseFen(fen))
+		return true;
+	ParseFen(START_FEN);
+	return false;
+}
+
+bool Position::ParseFen(std::string_view fen) noexcept
+{
+	Clear();
+
+	// 棋子部分，从黑方底线开始
+	auto space = fen.find(' ');
+	std::string_view board = fen.substr(0, space);
+	int file = 0;
+	int rank = BOARD_RANK_NB - 1;
+	for (char c : board)
+	{
+		if (c == '/')
+		{
+			if (file != BOARD_FILE_NB || rank == 0)
+				return false;
+			file = 0;
+			rank--;
+		}
+		else if (c >= '1' && c <= '9')
+		{
+			file += c - '0';
+			if (file > BOARD_FILE_NB)
+				return false;
+		}
+		else
+		{
+			auto piece = CharToPiece(c);
+			if (!piece.has_value() || file >= BOARD_FILE_NB || !IsValidPieceSquare(*piece, MakeSquare(file, rank)))
+				return false;
+			PutPiece(*piece, MakeSquare(file, rank));
+			file++;
+		}
+	}
+	if (file != BOARD_FILE_NB || rank != 0)
+		return false;
+	for (const auto player : { PlayerType::Red, PlayerType::Black })
+	{
+		if (Pieces(player, PieceType::King).Count() != 1)
+			return false;
+		for (int piece = 0; piece < PIECE_TYPE_NB; piece++)
+		{
+			if (Pieces(player, static_cast<PieceType>(piece)).Count() > MAX_PIECE_COUNT[piece])
+				return false;
+		}
+	}
+
+	// 走子方，后面的两个"-"和回合数都是可选的
+	std::string_view rest = space == std::string_view::npos ? std::string_view{} : fen.substr(space + 1);
+	if (!rest.empty())
+	{
+		if (rest.front() == 'b')
+			m_side = PlayerType::Black;
+		else if (rest.front() != 'w' && rest.front() != 'r')
+			return false;
+
+		// 跳过两个"-"，取没有吃子的步数
+		for (int i = 0; i < 3 && !rest.empty(); i++)
+		{
+			auto pos_space = rest.find(' ');
+			rest = pos_space == std::string_view::npos ? std::string_view{} : rest.substr(pos_space + 1);
+		}
+		int rule_moves = 0;
+		if (auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), rule_moves); ec == std::errc{} && rule_moves >= 0)
+			m_states[0].rule_moves = static_cast<std::uint16_t>(rule_moves);
+	}
+
+	const auto us = m_side;
+	// 不该走棋的一方被将军说明局面不合法
+	if (CheckersTo(KingSquare(Opponent(us)), us, Occupied()))
+		return false;
+	m_states[0].key = ComputeKey();
+	m_states[0].pawn_key = ComputePawnKey();
+	m_states[0].checkers = CheckersTo(KingSquare(us), Opponent(us), Occupied());
+
+	return true;
+}
+
+std::string Position::GetFen() const
+{
+	std::string fen;
+	for (int rank = BOARD_RANK_NB - 1; rank >= 0; rank--)
+	{
+		int empty = 0;
+		for (int file = 0; file < BOARD_FILE_NB; file++)
+		{
+			auto piece = m_board[MakeSquare(file, rank)];
+			if (piece == PlayerPieceType::None)
+			{
+				empty++;
+				continue;
+			}
+			if (empty > 0)
+				fen += static_cast<char>('0' + empty);
+			empty = 0;
+			fen += PieceToChar(piece);
+		}
+		if (empty > 0)
+			fen += static_cast<char>('0' + empty);
+		if (rank > 0)
+			fen += '/';
+	}
+	fen += m_side == PlayerType::Red ? " w - - " : " b - - ";
+	fen += std::to_string(RuleMoves());
+	fen += " 1";
+	return fen;
+}
+
+void Position::PutPiece(PlayerPieceType piece, Square sq) noexcept
+{
+	m_board[sq] = piece;
+	m_pieces[PieceIndex(piece)] |= sq;
+	m_occupied[PlayerIndex(DeComposePlayerPiece(piece).first)] |= sq;
+}
+
+void Position::RemovePiece(Square sq) noexcept
+{
+	const auto piece = m_board[sq];
+	m_pieces[PieceIndex(piece)] ^= sq;
+	m_occupied[PlayerIndex(DeComposePlayerPiece(piece).first)] ^= sq;
+	m_board[sq] = PlayerPieceType::None;
+}
+
+void Position::MovePiece(Square from, Square to) noexcept
+{
+	const auto piece = m_board[from];
+	const auto from_to = SquareBB(from) | SquareBB(to);
+	m_pieces[PieceIndex(piece)] ^= from_to;
+	m_occupied[PlayerIndex(DeComposePlayerPiece(piece).first)] ^= from_to;
+	m_board[from] = PlayerPieceType::None;
+	m_board[to] = piece;
+}
+
+std::uint64_t Position::ComputeKey() const noexcept
+{
+	std::uint64_t key = m_side == PlayerType::Black ? ZOBRIST.side : 0;
+	for (Bitboard bb = Occupied(); bb; )
+	{
+		const auto sq = bb.PopLsb();
+		key ^= ZOBRIST.pieces[PieceIndex(m_board[sq])][sq];
+	}
+	return key;
+}
+
+std::uint64_t Position::ComputePawnKey() const noexcept
+{
+	std::uint64_t key = 0;
+	for (Bitboard bb = m_pieces[PieceIndex(PlayerPieceType::RedPawn)] | m_pieces[PieceIndex(PlayerPieceType::BlackPawn)]; bb; )
+	{
+		const auto sq = bb.PopLsb();
+		key ^= ZOBRIST.pieces[PieceIndex(m_board[sq])][sq];
+	}
+	return key;
+}
+
+RepetitionType Position::GetRepetition() const noexcept
+{
+	const int end = std::min<int>(RuleMoves(), m_ply);
+	const auto key = Key();
+	// 两边在这个循环里是不是每一步都在将军
+	bool us_checking = true;
+	bool them_checking = true;
+	for (int i = 1; i <= end; i++)
+	{
+		// 倒数第i步走完之后的状态，i为奇数时这一步是对方走的
+		const bool is_check = m_states[m_ply - i + 1].checkers.Any();
+		if (i % 2 == 1)
+			them_checking &= is_check;
+		else
+			us_checking &= is_check;
+
+		if (i % 2 == 0 && i >= 4 && m_states[m_ply - i].key == key)
+		{
+			if (them_checking && !us_checking)
+				return RepetitionType::Win;
+			if (us_checking && !them_checking)
+				return RepetitionType::Loss;
+			return RepetitionType::Draw;
+		}
+	}
+	return RepetitionType::None;
+}
+
+CARP_CPU_DISPATCH Bitboard Position::AttackersTo(Square sq, PlayerType player, Bitboard occupied) const noexcept
+{
+	Bitboard attackers = RookAttacks(sq, occupied) & Pieces(player, PieceType::Rook);
+	attackers |= CannonAttacks(sq, occupied) & Pieces(player, PieceType::Cannon);
+	const auto knights = Pieces(player, PieceType::Knight);
+	for (const auto& target : KnightAttackers(sq))
+	{
+		if (knights.Test(target.to) && !occupied.Test(target.block))
+			attackers |= target.to;
+	}
+	const auto elephants = Pieces(player, PieceType::Elephant);
+	for (const auto& target : ElephantMoves(sq))
+	{
+		if (elephants.Test(target.to) && !occupied.Test(target.block))
+			attackers |= target.to;
+	}
+	attackers |= PawnAttackers(player, sq) & Pieces(player, PieceType::Pawn);
+	attackers |= AdvisorMoves(sq) & Pieces(player, PieceType::Advisor);
+	attackers |= KingMoves(sq) & Pieces(player, PieceType::King);
+	return attackers;
+}
+
+Bitboard Position::CheckersTo(Square king_sq, PlayerType player, Bitboard occupied) const noexcept
+{
+	// 两个将帅不可能在同一行，所以这里车的攻击范围和对方将帅相交就是照面
+	Bitboard checkers = RookAttacks(king_sq, occupied) & (Pieces(player, PieceType::Rook) | Pieces(player, PieceType::King));
+	checkers |= CannonAttacks(king_sq, occupied) & Pieces(player, PieceType::Cannon);
+	const auto knights = Pieces(player, PieceType::Knight);
+	for (const auto& target : KnightAttackers(king_sq))
+	{
+		if (knights.Test(target.to) && !occupied.Test(target.block))
+			checkers |= target.to;
+	}
+	checkers |= PawnAttackers(player, king_sq) & Pieces(player, PieceType::Pawn);
+	return checkers;
+}
+
+CARP_CPU_DISPATCH bool Position::IsSafeAfter(Move move) const noexcept
+{
+	const auto from = move.From();
+	const auto to = move.To();
+	const auto us = m_side;
+	const auto occupied = (Occupied() ^ from) | to;
+	const auto king_sq = m_board[from] == ComposePlayerPiece(us, PieceType::King) ? to : KingSquare(us);
+	// 被吃掉的子不能再攻击
+	return !(CheckersTo(king_sq, Opponent(us), occupied) & ~SquareBB(to));
+}
+
+std::uint64_t Position::KeyAfter(Move move) const noexcept
+{
+	const auto piece = m_board[move.From()];
+	const auto captured = m_board[move.To()];
+	std::uint64_t key = Key() ^ ZOBRIST.side ^ ZOBRIST.pieces[PieceIndex(piece)][move.From()] ^ ZOBRIST.pieces[PieceIndex(piece)][move.To()];
+	if (captured != PlayerPieceType::None)
+		key ^= ZOBRIST.pieces[PieceIndex(captured)][move.To()];
+	return key;
+}
+
+CARP_CPU_DISPATCH void Position::MakeMove(Move move) noexcept
+{
+	const auto from = move.From();
+	const auto to = move.To();
+	const auto piece = m_board[from];
+	const auto captured = m_board[to];
+	const auto& prev = m_states[m_ply];
+
+	std::uint64_t key = prev.key ^ ZOBRIST.side ^ ZOBRIST.pieces[PieceIndex(piece)][from] ^ ZOBRIST.pieces[PieceIndex(piece)][to];
+	std::uint64_t pawn_key = prev.pawn_key;
+	if (DeComposePlayerPiece(piece).second == PieceType::Pawn)
+		pawn_key ^= ZOBRIST.pieces[PieceIndex(piece)][from] ^ ZOBRIST.pieces[PieceIndex(piece)][to];
+	std::uint16_t rule_moves = static_cast<std::uint16_t>(prev.rule_moves + 1);
+	if (captured != PlayerPieceType::None)
+	{
+		key ^= ZOBRIST.pieces[PieceIndex(captured)][to];
+		if (DeComposePlayerPiece(captured).second == PieceType::Pawn)
+			pawn_key ^= ZOBRIST.pieces[PieceIndex(captured)][to];
+		rule_moves = 0;
+		RemovePiece(to);
+	}
+	MovePiece(from, to);
+	m_side = Opponent(m_side);
+
+	auto& state = m_states[++m_ply];
+	state.key = key;
+	state.pawn_key = pawn_key;
+	state.move = move;
+	state.captured = captured;
+	state.rule_moves = rule_moves;
+	state.checkers = CheckersTo(KingSquare(m_side), Opponent(m_side), Occupied());
+}
+
+void Position::UnmakeMove() noexcept
+{
+	const auto& state = m_states[m_ply--];
+	const auto from = state.move.From();
+	const auto to = state.move.To();
+	m_side = Opponent(m_side);
+	MovePiece(to, from);
+	if (state.captured != PlayerPieceType::None)
+		PutPiece(state.captured, to);
+}
+
+void Position::MakeNullMove() noexcept
+{
+	const auto& prev = m_states[m_ply];
+	auto& state = m_states[m_ply + 1];
+	state.key = prev.key ^ ZOBRIST.side;
+	state.pawn_key = prev.pawn_key;
+	state.move = Move{};
+	state.captured = PlayerPieceType::None;
+	state.rule_moves = static_cast<std::uint16_t>(prev.rule_moves + 1);
+	state.checkers = Bitboard{};
+	m_ply++;
+	m_side = Opponent(m_side);
+}
+
+void Position::UnmakeNullMove() noexcept
+{
+	m_ply--;
+	m_side = Opponent(m_side);
+}
+
+} // namespace Carp
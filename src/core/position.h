@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "def.h"
+#include "bitboard.h"
+#include "move.h"
+
+namespace Carp
+{
+
+constexpr std::string_view START_FEN = "rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C5C1/9/RNBAKABNR w - - 0 1";
+
+// 对局历史加上搜索的最大深度，超过就不能再走了
+constexpr int MAX_GAME_PLY = 1024;
+
+// 局面重复时的结果，都是对走子方来说的
+enum class RepetitionType
+{
+	None,
+	Draw,
+	Win,   // 对方长将
+	Loss,  // 自己长将
+};
+
+class Position
+{
+public:
+	Position();
+	// 只复制用到的那部分状态栈（0到m_ply），整个数组有几十KB，后面的都是悔棋留下的旧数据
+	Position(const Position& other) noexcept;
+	Position& operator=(const Position& other) noexcept;
+
+	// 直接解析到这个局面里，不经过临时的局面；解析失败时返回false，局面变成初始局面
+	// 子数超过开局时的数量，或者帅、士、相、兵不在能到的格子上，都算不合法
+	bool SetFen(std::string_view fen);
+	std::string GetFen() const;
+
+	PlayerPieceType PieceOn(Square sq) const noexcept { return m_board[sq]; }
+	bool IsEmpty(Square sq) const noexcept { return m_board[sq] == PlayerPieceType::None; }
+	PlayerType SideToMove() const noexcept { return m_side; }
+
+	Bitboard Pieces(PlayerPieceType piece) const noexcept { return m_pieces[PieceIndex(piece)]; }
+	Bitboard Pieces(PlayerType player, PieceType piece) const noexcept { return Pieces(ComposePlayerPiece(player, piece)); }
+	Bitboard Occupied(PlayerType player) const noexcept { return m_occupied[PlayerIndex(player)]; }
+	Bitboard Occupied() const noexcept { return m_occupied[0] | m_occupied[1]; }
+	Square KingSquare(PlayerType player) const noexcept { return Pieces(player, PieceType::King).Lsb(); }
+
+	std::uint64_t Key() const noexcept { return m_states[m_ply].key; }
+	// 走了move以后的键值，不用真的走，用来提前预取置换表
+	std::uint64_t KeyAfter(Move move) const noexcept;
+	// 只包含兵卒的键值，给修正历史用
+	std::uint64_t PawnKey() const noexcept { return m_states[m_ply].pawn_key; }
+	// 正在将军的子
+	Bitboard Checkers() const noexcept { return m_states[m_ply].checkers; }
+	bool InCheck() const noexcept { return m_states[m_ply].checkers.Any(); }
+	// 从设置局面开始走过的步数
+	int GamePly() const noexcept { return m_ply; }
+	// 上一次吃子以来走过的步数
+	int RuleMoves() const noexcept { return m_states[m_ply].rule_moves; }
+	Move LastMove() const noexcept { return m_states[m_ply].move; }
+	PlayerPieceType CapturedPiece() const noexcept { return m_states[m_ply].captured; }
+
+	// 检查当前局面是否和之前出现过的局面重复，长捉之类的规则暂时不考虑，都算作和棋
+	RepetitionType GetRepetition() const noexcept;
+
+	// 在给定的占位下，player一方所有能攻击到sq的子
+	Bitboard AttackersTo(Square sq, PlayerType player, Bitboard occupied) const noexcept;
+	// 走完这步之后自己的将帅是否安全，不检查走法本身是否符合规则
+	bool IsSafeAfter(Move move) const noexcept;
+
+	bool CanMakeMove() const noexcept { return m_ply + 1 < MAX_GAME_PLY; }
+	void MakeMove(Move move) noexcept;
+	void UnmakeMove() noexcept;
+	void MakeNullMove() noexcept;
+	void UnmakeNullMove() noexcept;
+
+private:
+	// 每走一步都要保存的状态，悔棋的时候直接退回去
+	struct StateInfo
+	{
+		std::uint64_t key;
+		std::uint64_t pawn_key;
+		Bitboard checkers;
+		Move move;
+		PlayerPieceType captured;
+		std::uint16_t rule_moves;
+	};
+
+	std::array<PlayerPieceType, SQUARE_NB> m_board;
+	std::array<Bitboard, PLAYER_PIECE_NB> m_pieces;
+	std::array<Bitboard, PLAYER_NB> m_occupied;
+	PlayerType m_side;
+	int m_ply;
+	std::array<StateInfo, MAX_GAME_PLY> m_states;
+
+	void Clear() noexcept;
+	// 先清空再解析，失败时局面是不完整的
+	bool ParseFen(std::string_view fen) noexcept;
+	void PutPiece(PlayerPieceType piece, Square sq) noexcept;
+	void RemovePiece(Square sq) noexcept;
+	void MovePiece(Square from, Square to) noexcept;
+	std::uint64_t ComputeKey() const noexcept;
+	std::uint64_t ComputePawnKey() const noexcept;
+	// 只算能将军的子，包括将帅照面
+	Bitboard CheckersTo(Square king_sq, PlayerType player, Bitboard occupied) const noexcept;
+};
+
+} // namespace Carp
@@ -0,0 +1,951 @@
+#include "search.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "utils/async_output.h"
+#include "utils/trace.h"
+#include "eval_hash.h"
+#include "evaluate.h"
+#include "mate_search.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "search_arena.h"
+#include "see.h"
+#include "thread_budget.h"
+#include "tt.h"
+
+namespace Carp
+{
+
+// 没有吃子的步数超过这个就判和，相当于60回合自然限着
+constexpr int RULE_MOVES_LIMIT = 120;
+// 给输出和通信留的时间
+constexpr std::int64_t MOVE_OVERHEAD = 30;
+// 搜索时间超过这个才输出currmove
+constexpr std::int64_t CURRMOVE_DELAY = 3000;
+constexpr Value ASPIRATION_DELTA = 50;
+// 奇异延伸：置换表走法的深度够深才做验证搜索，其它走法都比它差这么多（乘以深度）就延伸
+constexpr int SINGULAR_MIN_DEPTH = 6;
+constexpr Value SINGULAR_MARGIN = 2;
+// 修正历史的值是实际修正量的这么多倍
+constexpr int CORRECTION_GRAIN = 8;
+constexpr std::size_t MAX_QUIETS_TRIED = 64;
+// 对方提和时，局面落后超过这么多才接受
+constexpr Value DRAW_ACCEPT_SCORE = -50;
+
+// 一个搜索线程，线程一直在后台等着，开始搜索时唤醒
+class SearchWorker
+{
+public:
+	SearchWorker(Search& search, std::size_t index);
+	~SearchWorker();
+	SearchWorker(const SearchWorker&) = delete;
+	SearchWorker& operator=(const SearchWorker&) = delete;
+
+	// 开始搜索前由Search调用，这时线程是空闲的
+	void Prepare(const Position& root, bool clear);
+	// fixed_depth大于0时只搜这一层，确定性模式下由主线程调度
+	void StartSearching(int fixed_depth = 0);
+	void WaitForSearchFinished();
+	// 在调用者的线程上搜索，不启动其它线程，也不输出，调用时线程必须是空闲的
+	SearchResult RunNow();
+
+	SearchArena& Arena() noexcept { return *m_arena; }
+	const SearchArena& Arena() const noexcept { return *m_arena; }
+
+private:
+	Search& m_search;
+	const std::size_t m_index;
+	const std::unique_ptr<SearchArena> m_arena;
+	// 每个线程一个，队列只能有一个写的线程
+	InfoChannel* const m_channel;
+	Position m_pos;
+
+	int m_root_depth = 0;
+	int m_sel_depth = 0;
+	// 最后一次完整搜完的迭代的结果
+	int m_completed_depth = 0;
+	Value m_best_score = -VALUE_INFINITE;
+	Move m_best_move;
+	Move m_ponder_move;
+	// 和上面的结果对应的完整变例，bestmove用了其它线程的结果时输出它的变例
+	std::vector<Move> m_best_pv;
+	int m_best_sel_depth = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_searching = false;
+	bool m_quit = false;
+	int m_fixed_depth = 0;
+	// 放在最后，保证线程开始运行时其它成员都已经初始化了
+	std::thread m_thread;
+
+	void IdleLoop();
+	void RunMain();
+	void RunDeterministic(int max_depth);
+	// 用证明数搜索找杀棋，找到了返回true并设置最佳走法和分数
+	bool RunMate();
+	void IterativeDeepening();
+	// 搜索一层，被停止时返回false，结果不用
+	bool SearchDepth(int depth);
+	bool IsMain() const noexcept { return m_index == 0; }
+	bool IsRootMoveAllowed(Move move) const noexcept;
+	bool Stopped() const noexcept { return m_search.m_stop.load(std::memory_order_relaxed); }
+
+	void CountNode() noexcept;
+	void CheckLimits() noexcept;
+	Value Eval() noexcept;
+	Value CorrectEval(Value raw_eval) const noexcept;
+	void UpdateCorrection(Value best_value, Value static_eval, int depth) noexcept;
+	void UpdatePv(SearchStack* ss, Move move) noexcept;
+	void UpdateQuietStats(SearchStack* ss, Move move, std::span<const Move> quiets, int depth) noexcept;
+
+	Value Negamax(SearchStack* ss, int depth, Value alpha, Value beta);
+	Value QSearch(SearchStack* ss, Value alpha, Value beta);
+};
+
+SearchWorker::SearchWorker(Search& search, std::size_t index) :
+	m_search(search),
+	m_index(index),
+	m_arena(std::make_unique<SearchArena>()),
+	m_channel(search.m_output.CreateChannel()),
+	m_thread(&SearchWorker::IdleLoop, this)
+{
+	m_arena->Clear();
+	m_best_pv.reserve(MAX_PLY);
+}
+
+SearchWorker::~SearchWorker()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_quit = true;
+	}
+	m_cv.notify_all();
+	m_thread.join();
+	m_search.m_output.RemoveChannel(m_channel);
+}
+
+void SearchWorker::Prepare(const Position& root, bool clear)
+{
+	m_pos = root;
+	if (clear)
+		m_arena->Clear();
+	else
+		m_arena->ResetForSearch();
+	m_root_depth = 0;
+	m_completed_depth = 0;
+	m_best_score = -VALUE_INFINITE;
+	m_best_move = m_ponder_move = Move{};
+	m_best_pv.clear();
+	m_best_sel_depth = 0;
+}
+
+void SearchWorker::StartSearching(int fixed_depth)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_searching = true;
+		m_fixed_depth = fixed_depth;
+	}
+	m_cv.notify_all();
+}
+
+void SearchWorker::WaitForSearchFinished()
+{
+	std::unique_lock lock(m_mutex);
+	m_cv.wait(lock, [this] { return !m_searching; });
+}
+
+void SearchWorker::IdleLoop()
+{
+	CARP_TRACE_THREAD_NAME("search " + std::to_string(m_index));
+	while (true)
+	{
+		std::unique_lock lock(m_mutex);
+		m_cv.wait(lock, [this] { return m_searching || m_quit; });
+		if (m_quit)
+			return;
+		const int fixed_depth = m_fixed_depth;
+		lock.unlock();
+
+		CARP_TRACE_SCOPE("search", "search", static_cast<std::int64_t>(m_index));
+		if (fixed_depth > 0)
+			SearchDepth(fixed_depth);
+		else if (IsMain())
+		{
+			RunMain();
+			m_search.EndSearch();
+		}
+		else
+			IterativeDeepening();
+
+		lock.lock();
+		m_searching = false;
+		lock.unlock();
+		m_cv.notify_all();
+	}
+}
+
+void SearchWorker::RunMain()
+{
+	const auto& format = *m_search.m_output_format;
+	const auto& limits = m_search.m_limits;
+	MoveList root_moves;
+	GenerateLegal<GenType::All>(m_pos, root_moves);
+	if (root_moves.empty())
+	{
+		if (limits.infinite)
+			m_search.WaitForStopRequest();
+		m_search.m_output.WriteNow(format.BestMove(Move{}, Move{}, false));
+		return;
+	}
+
+	m_best_move = m_search.m_root_moves.empty() ? root_moves[0].move : m_search.m_root_moves.front();
+	if (limits.mate.has_value())
+	{
+		RunMate();
+		if (limits.infinite)
+			m_search.WaitForStopRequest();
+		m_search.m_output.WriteNow(format.BestMove(m_best_move, m_ponder_move, false));
+		return;
+	}
+
+	if (m_search.m_deterministic)
+	{
+		RunDeterministic(std::min(limits.depth, MAX_PLY - 1));
+		if (limits.infinite)
+			m_search.WaitForStopRequest();
+	}
+	else
+	{
+		for (std::size_t i = 1; i < m_search.m_active_threads; i++)
+			m_search.m_workers[i]->StartSearching();
+		IterativeDeepening();
+		// 搜到最大深度了也要等stop
+		if (limits.infinite)
+			m_search.WaitForStopRequest();
+
+		CARP_TRACE_SCOPE("search", "wait helpers");
+		m_search.m_stop = true;
+		for (std::size_t i = 1; i < m_search.m_active_threads; i++)
+			m_search.m_workers[i]->WaitForSearchFinished();
+	}
+
+	// 其它线程搜得更深的话用它的结果
+	const SearchWorker* best = this;
+	for (std::size_t i = 1; i < m_search.m_active_threads; i++)
+	{
+		const auto* worker = m_search.m_workers[i].get();
+		if (worker->m_best_move && (worker->m_completed_depth > best->m_completed_depth
+			|| (worker->m_completed_depth == best->m_completed_depth && worker->m_best_score > best->m_best_score)))
+			best = worker;
+	}
+	// 最后一条info的变例要和bestmove、ponder出自同一个线程
+	if (best != this)
+	{
+		const SearchInfo info{ best->m_completed_depth, best->m_best_sel_depth, best->m_best_score,
+			m_search.TotalNodes(), m_search.Elapsed(), best->m_best_pv };
+		m_channel->Post(InfoKind::Pv, format.Info(info));
+	}
+	const bool accept_draw = limits.draw_offered && best->m_completed_depth > 0 && best->m_best_score <= DRAW_ACCEPT_SCORE;
+	m_search.m_output.WriteNow(format.BestMove(best->m_best_move, best->m_ponder_move, accept_draw));
+	m_search.DumpTrace();
+}
+
+SearchResult SearchWorker::RunNow()
+{
+	MoveList root_moves;
+	GenerateLegal<GenType::All>(m_pos, root_moves);
+	if (root_moves.empty())
+		return SearchResult{ Move{}, Move{}, -VALUE_MATE, 0, 0 };
+
+	m_best_move = m_search.m_root_moves.empty() ? root_moves[0].move : m_search.m_root_moves.front();
+	if (m_search.m_limits.mate.has_value())
+		RunMate();
+	else
+		IterativeDeepening();
+	return SearchResult{ m_best_move, m_ponder_move, m_best_score, m_completed_depth, m_arena->nodes.load(std::memory_order_relaxed) };
+}
+
+void SearchWorker::RunDeterministic(int max_depth)
+{
+	// 每一层先让辅助线程按编号依次搜，再由主线程搜，同一时间只有一个线程在跑
+	// 置换表的读写顺序固定，结果只和节点数有关
+	const auto& workers = m_search.m_workers;
+	for (int depth = 1; depth <= max_depth; depth++)
+	{
+		for (std::size_t i = 1; i < m_search.m_active_threads && !Stopped(); i++)
+		{
+			const int helper_depth = depth + static_cast<int>(i % 2);
+			if (helper_depth > max_depth)
+				continue;
+			workers[i]->StartSearching(helper_depth);
+			workers[i]->WaitForSearchFinished();
+		}
+		if (Stopped() || !SearchDepth(depth))
+			break;
+	}
+	m_search.m_stop = true;
+}
+
+bool SearchWorker::RunMate()
+{
+	const MateSearchLimits mate_limits{ *m_search.m_limits.mate, m_search.m_limits.nodes.value_or(0), m_search.m_root_moves };
+	m_root_depth = 2 * std::clamp(mate_limits.max_moves, 1, MAX_MATE_MOVES) - 1;
+	const auto result = FindMate(m_pos, mate_limits, [this](std::uint64_t nodes) {
+		m_arena->nodes.store(nodes, std::memory_order_relaxed);
+		CheckLimits();
+		return Stopped();
+	});
+	m_arena->nodes.store(result.nodes, std::memory_order_relaxed);
+	if (result.best)
+		m_best_move = result.best;
+	if (result.moves == 0)
+		return false;
+
+	const int plies = static_cast<int>(result.pv.size());
+	m_ponder_move = plies > 1 ? result.pv[1] : Move{};
+	m_best_score = VALUE_MATE - plies;
+	m_completed_depth = plies;
+	if (m_search.m_output_format != nullptr)
+	{
+		const SearchInfo info{ plies, plies, m_best_score, result.nodes, m_search.Elapsed(), result.pv };
+		m_channel->Post(InfoKind::Pv, m_search.m_output_format->Info(info));
+	}
+	return true;
+}
+
+void SearchWorker::IterativeDeepening()
+{
+	// 辅助线程错开一层开始，减少和主线程做同样的事情
+	const int start_depth = 1 + static_cast<int>(m_index % 2);
+	for (int depth = start_depth; depth <= std::min(m_search.m_limits.depth, MAX_PLY - 1); depth++)
+	{
+		if (!SearchDepth(depth))
+			break;
+
+		// 下一层一般要花更多的时间，剩下的时间不够就不搜了
+		if (IsMain() && m_search.m_soft_limit > 0 && m_search.Elapsed() * 2 > m_search.m_soft_limit)
+			break;
+	}
+}
+
+bool SearchWorker::SearchDepth(int depth)
+{
+	CARP_TRACE_SCOPE("search", "iteration", depth);
+	auto* const ss = m_arena->Root();
+	m_root_depth = depth;
+	m_sel_depth = 0;
+
+	// 渴望窗口，失败了就逐步放宽
+	Value delta = ASPIRATION_DELTA;
+	Value alpha = -VALUE_INFINITE;
+	Value beta = VALUE_INFINITE;
+	if (depth >= 4 && m_completed_depth > 0)
+	{
+		alpha = std::max(m_best_score - delta, -VALUE_INFINITE);
+		beta = std::min(m_best_score + delta, VALUE_INFINITE);
+	}
+	Value value;
+	for (int attempt = 0; ; attempt++)
+	{
+		{
+			// 第一次之后的都是窗口失败后的重新搜索
+			CARP_TRACE_SCOPE("search", attempt == 0 ? "window" : "re-search", depth);
+			value = Negamax(ss, depth, alpha, beta);
+		}
+		if (Stopped())
+			return false;
+		if (value <= alpha)
+		{
+			beta = (alpha + beta) / 2;
+			alpha = std::max(value - delta, -VALUE_INFINITE);
+		}
+		else if (value >= beta)
+			beta = std::min(value + delta, VALUE_INFINITE);
+		else
+			break;
+		delta += delta / 2;
+	}
+
+	m_completed_depth = depth;
+	m_best_score = value;
+	m_best_move = ss->pv[0];
+	m_ponder_move = ss->pv_length > 1 ? ss->pv[1] : Move{};
+	m_best_pv.assign(ss->pv.data(), ss->pv.data() + ss->pv_length);
+	m_best_sel_depth = m_sel_depth;
+	if (IsMain() && m_search.m_output_format != nullptr)
+	{
+		const SearchInfo info{ depth, m_sel_depth, value, m_search.TotalNodes(), m_search.Elapsed(),
+			std::span<const Move>{ ss->pv.data(), static_cast<std::size_t>(ss->pv_length) } };
+		m_channel->Post(InfoKind::Pv, m_search.m_output_format->Info(info));
+	}
+	return true;
+}
+
+bool SearchWorker::IsRootMoveAllowed(Move move) const noexcept
+{
+	const auto& root_moves = m_search.m_root_moves;
+	return root_moves.empty() || std::ranges::find(root_moves, move) != root_moves.end();
+}
+
+void SearchWorker::CountNode() noexcept
+{
+	// 只有自己会写，不需要原子的加法
+	const auto nodes = m_arena->nodes.load(std::memory_order_relaxed) + 1;
+	m_arena->nodes.store(nodes, std::memory_order_relaxed);
+	// 确定性模式下每个节点都要检查，停在哪个节点上才是固定的
+	if (m_search.m_deterministic || (IsMain() && (nodes & 1023) == 0))
+		CheckLimits();
+}
+
+void SearchWorker::CheckLimits() noexcept
+{
+	const auto& limits = m_search.m_limits;
+	if (limits.nodes.has_value() && m_search.TotalNodes() >= *limits.nodes)
+		m_search.m_stop = true;
+	// 至少要搜完第一层，保证有走法可以输出
+	if (!m_search.m_deterministic && m_root_depth > 1 && m_search.m_hard_limit > 0 && m_search.Elapsed() >= m_search.m_hard_limit)
+		m_search.m_stop = true;
+}
+
+Value SearchWorker::Eval() noexcept
+{
+	CARP_STATS_INC(m_arena->stats, eval_calls);
+	CARP_STATS_TIMER(m_arena->stats, eval_ns);
+	auto* const eval_hash = m_search.m_eval_hash;
+	if (eval_hash == nullptr || !eval_hash->Enabled())
+		return Evaluate(m_pos);
+
+	// 置换表没命中或者没存评估的局面，以及窗口失败、LMR重新搜索时，同一个局面会反复评估
+	Value value;
+	if (eval_hash->Probe(m_pos.Key(), value))
+	{
+		CARP_STATS_INC(m_arena->stats, eval_hash_hits);
+		return value;
+	}
+	value = Evaluate(m_pos);
+	eval_hash->Store(m_pos.Key(), value);
+	return value;
+}
+
+Value SearchWorker::CorrectEval(Value raw_eval) const noexcept
+{
+	const auto correction = m_arena->correction_history[PlayerIndex(m_pos.SideToMove())][m_pos.PawnKey() % CORRECTION_HISTORY_SIZE];
+	return std::clamp(raw_eval + correction / CORRECTION_GRAIN, -VALUE_MATE_IN_MAX_PLY + 1, VALUE_MATE_IN_MAX_PLY - 1);
+}
+
+void SearchWorker::UpdateCorrection(Value best_value, Value static_eval, int depth) noexcept
+{
+	auto& entry = m_arena->correction_history[PlayerIndex(m_pos.SideToMove())][m_pos.PawnKey() % CORRECTION_HISTORY_SIZE];
+	UpdateHistory<CORRECTION_HISTORY_LIMIT>(entry, (best_value - static_eval) * depth * CORRECTION_GRAIN / 8);
+}
+
+void SearchWorker::UpdatePv(SearchStack* ss, Move move) noexcept
+{
+	const auto* child = ss + 1;
+	ss->pv[0] = move;
+	std::copy_n(child->pv.begin(), child->pv_length, ss->pv.begin() + 1);
+	ss->pv_length = child->pv_length + 1;
+}
+
+void SearchWorker::UpdateQuietStats(SearchStack* ss, Move move, std::span<const Move> quiets, int depth) noexcept
+{
+	if (ss->killers[0] != move)
+	{
+		ss->killers[1] = ss->killers[0];
+		ss->killers[0] = move;
+	}
+
+	const int bonus = std::min(24 * depth * depth, HISTORY_LIMIT / 8);
+	auto update = [&](Move m, int value) {
+		const auto piece = PieceIndex(m_pos.PieceOn(m.From()));
+		const auto to = m.To();
+		UpdateHistory<HISTORY_LIMIT>(m_arena->main_history[piece][to], value);
+		// 前面是空着或者根节点的话没有续着历史
+		for (int i = 1; i <= 2; i++)
+		{
+			if ((ss - i)->current_move)
+				UpdateHistory<HISTORY_LIMIT>((*(ss - i)->cont_history)[piece][to], value);
+		}
+	};
+	update(move, bonus);
+	for (const auto quiet : quiets)
+		update(quiet, -bonus);
+}
+
+Value SearchWorker::Negamax(SearchStack* ss, int depth, Value alpha, Value beta)
+{
+	if (depth <= 0)
+		return QSearch(ss, alpha, beta);
+
+	const int ply = static_cast<int>(ss - m_arena->Root());
+	const bool root_node = ply == 0;
+	const bool pv_node = beta - alpha > 1;
+	// 奇异延伸的验证搜索，和正常搜索是同一个局面，只是少了一个走法
+	const Move excluded_move = ss->excluded_move;
+	ss->pv_length = 0;
+
+	CountNode();
+	CARP_STATS_INC(m_arena->stats, nodes);
+	if (Stopped())
+		return VALUE_DRAW;
+
+	if (!root_node)
+	{
+		switch (m_pos.GetRepetition())
+		{
+		case RepetitionType::Draw: return VALUE_DRAW;
+		case RepetitionType::Win: return VALUE_PERPETUAL - ply;
+		case RepetitionType::Loss: return -VALUE_PERPETUAL + ply;
+		case RepetitionType::None: break;
+		}
+		if (m_pos.RuleMoves() >= RULE_MOVES_LIMIT)
+			return VALUE_DRAW;
+		if (ply >= MAX_PLY - 1 || !m_pos.CanMakeMove())
+			return Eval();
+
+		// 杀棋步数裁剪，已经找到更短的杀棋就不用再搜了
+		alpha = std::max(alpha, -VALUE_MATE + ply);
+		beta = std::min(beta, VALUE_MATE - ply - 1);
+		if (alpha >= beta)
+			return alpha;
+	}
+
+	// 置换表是多线程共享的，读出来的走法要检查是否合法
+	const auto key = m_pos.Key();
+	bool tt_hit = false;
+	TTEntry* tte;
+	{
+		CARP_STATS_TIMER(m_arena->stats, tt_probe_ns);
+		tte = m_search.m_tt.Probe(key, tt_hit);
+	}
+	CARP_STATS_INC(m_arena->stats, tt_probes);
+	if (tt_hit)
+		CARP_STATS_INC(m_arena->stats, tt_hits);
+	const Value tt_value = tt_hit ? ValueFromTT(tte->GetValue(), ply) : VALUE_NONE;
+	Move tt_move = root_node && m_best_move ? m_best_move : tt_hit ? tte->GetMove() : Move{};
+	if (tt_move && !IsLegalMove(m_pos, tt_move))
+		tt_move = Move{};
+
+	if (!pv_node && !excluded_move && tt_hit && tte->GetDepth() >= depth && tt_value != VALUE_NONE)
+	{
+		const auto bound = static_cast<std::uint8_t>(tte->GetBound());
+		if ((tt_value >= beta && (bound & static_cast<std::uint8_t>(Bound::Lower)))
+			|| (tt_value < beta && (bound & static_cast<std::uint8_t>(Bound::Upper))))
+			return tt_value;
+	}
+
+	const auto us = m_pos.SideToMove();
+	const bool in_check = m_pos.InCheck();
+	Value raw_eval = VALUE_NONE;
+	ss->static_eval = VALUE_NONE;
+	if (!in_check)
+	{
+		raw_eval = tt_hit && tte->GetEval() != VALUE_NONE ? tte->GetEval() : Eval();
+		ss->static_eval = CorrectEval(raw_eval);
+	}
+
+	// 空着裁剪，残局里只剩兵、士、象的时候容易出现等着的局面，不做
+	if (!pv_node && !in_check && !root_node && !excluded_move && depth >= 3 && (ss - 1)->current_move
+		&& (m_pos.Pieces(us, PieceType::Rook) | m_pos.Pieces(us, PieceType::Knight) | m_pos.Pieces(us, PieceType::Cannon))
+		&& ss->static_eval >= beta)
+	{
+		CARP_STATS_INC(m_arena->stats, null_tries);
+		const int reduction = 2 + depth / 4;
+		ss->current_move = Move{};
+		ss->cont_history = &m_arena->cont_history[PieceIndex(PlayerPieceType::None)][0];
+		m_pos.MakeNullMove();
+		const Value value = -Negamax(ss + 1, depth - 1 - reduction, -beta, -beta + 1);
+		m_pos.UnmakeNullMove();
+		if (Stopped())
+			return VALUE_DRAW;
+		if (value >= beta)
+		{
+			CARP_STATS_INC(m_arena->stats, null_cutoffs);
+			return value >= VALUE_MATE_IN_MAX_PLY ? beta : value;
+		}
+	}
+
+	const std::array<const PieceToHistory*, 2> cont_history{ (ss - 1)->cont_history, (ss - 2)->cont_history };
+	MovePicker picker(m_pos, tt_move, ss->killers, m_arena->main_history, cont_history, m_arena->stats);
+	std::array<Move, MAX_QUIETS_TRIED> quiets;
+	std::size_t quiet_count = 0;
+	Value best_value = -VALUE_INFINITE;
+	Move best_move;
+	int move_count = 0;
+	while (const auto move = picker.Next())
+	{
+		if ((root_node && !IsRootMoveAllowed(move)) || move == excluded_move)
+			continue;
+		// 子节点一进去就要读置换表，先发出预取，等待的时间和下面走子、设置历史表的工作重叠
+		// 剩一层的子节点直接进静态搜索，不读置换表
+		if (m_search.m_prefetch)
+		{
+			const auto child_key = m_pos.KeyAfter(move);
+			if (depth > 1)
+			{
+				m_search.m_tt.Prefetch(child_key);
+				CARP_STATS_INC(m_arena->stats, tt_prefetches);
+			}
+			// 子节点不管进不进静态搜索都要评估
+			if (m_search.m_eval_hash != nullptr && m_search.m_eval_hash->Enabled())
+				m_search.m_eval_hash->Prefetch(child_key);
+		}
+		move_count++;
+		const bool capture = !m_pos.IsEmpty(move.To());
+
+		if (root_node && IsMain() && m_search.m_output_format != nullptr && m_search.Elapsed() > CURRMOVE_DELAY)
+			m_channel->Post(InfoKind::CurrMove, m_search.m_output_format->CurrMove(move, move_count));
+
+		// 奇异延伸：置换表走法明显比其它走法都好时多搜一层
+		// 去掉它以后的验证搜索仍然高于beta，说明有好几个走法都能剪枝（multi-cut），直接返回
+		int extension = 0;
+		if (!root_node && move == tt_move && !excluded_move && depth >= SINGULAR_MIN_DEPTH
+			&& tt_hit && (static_cast<std::uint8_t>(tte->GetBound()) & static_cast<std::uint8_t>(Bound::Lower))
+			&& tte->GetDepth() >= depth - 3 && std::abs(tt_value) < VALUE_MATE_IN_MAX_PLY)
+		{
+			CARP_STATS_INC(m_arena->stats, singular_tests);
+			const Value singular_beta = tt_value - SINGULAR_MARGIN * depth;
+			ss->excluded_move = move;
+			const Value value = Negamax(ss, (depth - 1) / 2, singular_beta - 1, singular_beta);
+			ss->excluded_move = Move{};
+			if (Stopped())
+				return VALUE_DRAW;
+			if (value < singular_beta)
+			{
+				CARP_STATS_INC(m_arena->stats, singular_extensions);
+				extension = 1;
+			}
+			else if (singular_beta >= beta)
+			{
+				CARP_STATS_INC(m_arena->stats, multi_cuts);
+				return singular_beta;
+			}
+		}
+
+		ss->current_move = move;
+		ss->cont_history = &m_arena->cont_history[PieceIndex(m_pos.PieceOn(move.From()))][move.To()];
+		m_pos.MakeMove(move);
+		const bool gives_check = m_pos.InCheck();
+		// 将军延伸：象棋里将军很多，送给对方吃的将军一般没什么用，只延伸吃子的或者对方吃不掉将军的子的
+		if (gives_check && (capture || !m_pos.AttackersTo(move.To(), m_pos.SideToMove(), m_pos.Occupied())))
+			extension = 1;
+		// 限制一下延伸的总层数
+		if (ply >= m_root_depth * 2)
+			extension = 0;
+		const int new_depth = depth - 1 + extension;
+
+		Value value;
+		if (move_count == 1)
+			value = -Negamax(ss + 1, new_depth, -beta, -alpha);
+		else
+		{
+			// 后面的不吃子走法先浅一点搜，有希望再正常搜
+			int reduction = 0;
+			if (depth >= 3 && move_count > 3 && !capture && !in_check && !gives_check)
+				reduction = std::min(1 + (move_count > 8 ? 1 : 0) + depth / 8, new_depth - 1);
+			if (reduction > 0)
+				CARP_STATS_INC(m_arena->stats, lmr_searches);
+
+			value = -Negamax(ss + 1, new_depth - reduction, -alpha - 1, -alpha);
+			if (reduction > 0 && value > alpha)
+			{
+				CARP_STATS_INC(m_arena->stats, lmr_researches);
+				value = -Negamax(ss + 1, new_depth, -alpha - 1, -alpha);
+			}
+			if (pv_node && value > alpha && value < beta)
+				value = -Negamax(ss + 1, new_depth, -beta, -alpha);
+		}
+		m_pos.UnmakeMove();
+
+		if (Stopped())
+			return VALUE_DRAW;
+
+		if (value > best_value)
+		{
+			best_value = value;
+			if (value > alpha)
+			{
+				alpha = value;
+				best_move = move;
+				UpdatePv(ss, move);
+				if (value >= beta)
+				{
+					CARP_STATS_INC(m_arena->stats, cutoffs);
+					if (move_count == 1)
+						CARP_STATS_INC(m_arena->stats, first_move_cutoffs);
+					break;
+				}
+			}
+		}
+		if (!capture && quiet_count < quiets.size())
+			quiets[quiet_count++] = move;
+	}
+
+	// 象棋里没有合法走法就是输了，困毙也一样；验证搜索时只是去掉的那个走法是唯一的走法
+	if (move_count == 0)
+		return excluded_move ? alpha : -VALUE_MATE + ply;
+	// 验证搜索的结果不完整，不能存进置换表
+	if (excluded_move)
+		return best_value;
+
+	const bool best_is_quiet = best_move && m_pos.IsEmpty(best_move.To());
+	if (best_value >= beta && best_is_quiet)
+		UpdateQuietStats(ss, best_move, std::span<const Move>{ quiets.data(), quiet_count }, depth);
+
+	const Bound bound = best_value >= beta ? Bound::Lower : pv_node && best_move ? Bound::Exact : Bound::Upper;
+	tte->Save(key, ValueToTT(best_value, ply), bound, depth, best_move, raw_eval, m_search.m_tt.Generation());
+
+	// 搜索结果和静态评估差得多，说明这种兵型下评估有偏差
+	if (!in_check && (!best_move || best_is_quiet) && std::abs(best_value) < VALUE_MATE_IN_MAX_PLY
+		&& !(bound == Bound::Lower && best_value <= ss->static_eval)
+		&& !(bound == Bound::Upper && best_value >= ss->static_eval))
+		UpdateCorrection(best_value, ss->static_eval, depth);
+
+	return best_value;
+}
+
+Value SearchWorker::QSearch(SearchStack* ss, Value alpha, Value beta)
+{
+	const int ply = static_cast<int>(ss - m_arena->Root());
+	// 静态搜索不记录变例，父节点不能拿到上一次留下的
+	ss->pv_length = 0;
+	CountNode();
+	CARP_STATS_INC(m_arena->stats, nodes);
+	CARP_STATS_INC(m_arena->stats, qnodes);
+	if (Stopped())
+		return VALUE_DRAW;
+
+	m_sel_depth = std::max(m_sel_depth, ply);
+	if (ply >= MAX_PLY - 1 || !m_pos.CanMakeMove())
+		return Eval();
+
+	const bool in_check = m_pos.InCheck();
+	Value best_value = -VALUE_MATE + ply;
+	if (!in_check)
+	{
+		best_value = CorrectEval(Eval());
+		if (best_value >= beta)
+			return best_value;
+		alpha = std::max(alpha, best_value);
+	}
+
+	MovePicker picker(m_pos, m_arena->stats);
+	while (const auto move = picker.Next())
+	{
+		// 亏本的吃子直接跳过，被将军的时候不跳
+		if (!in_check && !SeeGe(m_pos, move, 0))
+			continue;
+
+		m_pos.MakeMove(move);
+		const Value value = -QSearch(ss + 1, -beta, -alpha);
+		m_pos.UnmakeMove();
+
+		if (Stopped())
+			return VALUE_DRAW;
+
+		if (value > best_value)
+		{
+			best_value = value;
+			if (value > alpha)
+			{
+				alpha = value;
+				if (value >= beta)
+					break;
+			}
+		}
+	}
+	return best_value;
+}
+
+Search::Search(AsyncOutput& output, TranspositionTable& tt) :
+	m_output(output),
+	m_tt(tt)
+{
+	SetThreads(1);
+}
+
+Search::~Search()
+{
+	Stop();
+	Wait();
+	m_workers.clear();
+}
+
+void Search::SetThreads(std::size_t count)
+{
+	Stop();
+	Wait();
+	// 多出来的线程拿不到核心，只会白占内存
+	if (m_budget)
+		count = std::min(count, m_budget->Cores());
+	m_workers.clear();
+	m_workers.reserve(count);
+	for (std::size_t i = 0; i < count; i++)
+		m_workers.push_back(std::make_unique<SearchWorker>(*this, i));
+}
+
+void Search::Start(const Position& pos, const SearchLimits& limits, const OutputSearch& output_format)
+{
+	Wait();
+	m_limits = limits;
+	m_output_format = &output_format;
+	m_start_time = std::chrono::steady_clock::now();
+	{
+		std::lock_guard lock(m_stop_mutex);
+		m_stop_requested = false;
+	}
+	m_stop = false;
+	InitTimeLimits();
+	InitRootMoves(pos);
+	m_active_threads = m_budget ? m_budget->Acquire(m_workers.size()) : m_workers.size();
+	if (m_deterministic)
+		m_tt.Clear();
+	m_tt.BeginSearch();
+	for (auto& worker : m_workers)
+		worker->Prepare(pos, m_deterministic);
+	m_workers.front()->StartSearching();
+}
+
+SearchResult Search::SearchNow(const Position& pos, const SearchLimits& limits)
+{
+	Wait();
+	m_limits = limits;
+	m_output_format = nullptr;
+	m_start_time = std::chrono::steady_clock::now();
+	m_stop = false;
+	InitTimeLimits();
+	InitRootMoves(pos);
+	m_tt.BeginSearch();
+	// 线程是空闲的，直接借用0号线程的工作区
+	auto& worker = *m_workers.front();
+	worker.Prepare(pos, m_deterministic);
+	const auto result = worker.RunNow();
+	m_tt.EndSearch();
+	return result;
+}
+
+void Search::Stop() noexcept
+{
+	CARP_TRACE_INSTANT("search", "stop");
+	{
+		std::lock_guard lock(m_stop_mutex);
+		m_stop_requested = true;
+	}
+	m_stop = true;
+	m_stop_cv.notify_all();
+}
+
+void Search::WaitForStopRequest()
+{
+	std::unique_lock lock(m_stop_mutex);
+	m_stop_cv.wait(lock, [this] { return m_stop_requested; });
+}
+
+void Search::EndSearch() noexcept
+{
+	if (m_budget)
+		m_budget->Release(m_active_threads);
+	m_tt.EndSearch();
+}
+
+void Search::SetTraceFile(std::string path)
+{
+	Wait();
+	m_trace_file = std::move(path);
+}
+
+void Search::DumpTrace() const
+{
+#ifdef CARP_TRACE
+	std::string error;
+	if (!m_trace_file.empty() && !Carp::DumpTrace(m_trace_file, error))
+		m_output.WriteNow("info string trace failed: " + error);
+#endif
+}
+
+void Search::Wait()
+{
+	// 主线程会等其它线程都结束了才结束
+	if (!m_workers.empty())
+		m_workers.front()->WaitForSearchFinished();
+}
+
+void Search::Clear()
+{
+	Wait();
+	for (auto& worker : m_workers)
+		worker->Arena().Clear();
+}
+
+std::string Search::GetStatsReport() const
+{
+	std::vector<SearchStats> stats;
+	stats.reserve(m_workers.size());
+	// 搜索线程可能还在计数，各项单独读出来，不是同一时刻的快照，报告用够了
+	for (const auto& worker : m_workers)
+	{
+		auto& thread_stats = stats.emplace_back(worker->Arena().stats);
+		thread_stats -= worker->Arena().stats_base;
+	}
+	return FormatStats(stats);
+}
+
+void Search::ResetStats() noexcept
+{
+	for (auto& worker : m_workers)
+		worker->Arena().stats_base = worker->Arena().stats;
+}
+
+void Search::InitTimeLimits()
+{
+	m_soft_limit = 0;
+	m_hard_limit = 0;
+	if (m_limits.infinite)
+		return;
+	if (m_limits.move_time.has_value())
+	{
+		m_soft_limit = m_hard_limit = std::max<std::int64_t>(*m_limits.move_time - MOVE_OVERHEAD, 1);
+	}
+	else if (m_limits.time.has_value())
+	{
+		const auto available = std::max<std::int64_t>(*m_limits.time - MOVE_OVERHEAD, 1);
+		const int moves_to_go = m_limits.moves_to_go > 0 ? std::min(m_limits.moves_to_go, 40) : 30;
+		// 最多用掉剩余时间的三分之一
+		m_hard_limit = moves_to_go == 1 ? available : std::max<std::int64_t>(available / 3, 1);
+		m_soft_limit = std::min(available / moves_to_go + m_limits.increment * 3 / 4, m_hard_limit);
+	}
+}
+
+void Search::InitRootMoves(const Position& pos)
+{
+	// 不合法的走法直接忽略，一个合法的都没有就不限制
+	m_root_moves.clear();
+	if (m_limits.search_moves.empty())
+		return;
+	MoveList legal;
+	GenerateLegal<GenType::All>(pos, legal);
+	for (const auto move : m_limits.search_moves)
+	{
+		if (legal.Contains(move) && std::ranges::find(m_root_moves, move) == m_root_moves.end())
+			m_root_moves.push_back(move);
+	}
+}
+
+std::int64_t Search::Elapsed() const noexcept
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start_time).count();
+}
+
+std::uint64_t Search::TotalNodes() const noexcept
+{
+	std::uint64_t nodes = 0;
+	for (const auto& worker : m_workers)
+		nodes += worker->Arena().nodes.load(std::memory_order_relaxed);
+	return nodes;
+}
+
+} // namespace Carp
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "def.h"
+#include "move.h"
+#include "position.h"
+#include "stats.h"
+
+namespace Carp
+{
+
+class AsyncOutput;
+
+// go命令给出的限制，时间都是毫秒
+struct SearchLimits
+{
+	int depth = MAX_PLY;
+	// 所有线程加起来的节点数
+	std::optional<std::uint64_t> nodes;
+	std::optional<std::int64_t> move_time;
+	// 己方剩余的时间和每步加时
+	std::optional<std::int64_t> time;
+	std::int64_t increment = 0;
+	int moves_to_go = 0;
+	// 一直搜到stop为止，搜完了也要等stop才输出bestmove
+	bool infinite = false;
+	// 根节点只考虑这些走法，空的话不限制
+	std::vector<Move> search_moves;
+	// 找几步之内的杀棋，用证明数搜索代替普通的搜索
+	std::optional<int> mate;
+	// 对方提和（UCCI的go draw），局面不好就在bestmove后面接受
+	bool draw_offered = false;
+};
+
+struct SearchInfo
+{
+	int depth;
+	int sel_depth;
+	Value score;
+	std::uint64_t nodes;
+	std::int64_t time;
+	std::span<const Move> pv;
+};
+
+// 同步搜索的结果，分数是走子方的角度
+struct SearchResult
+{
+	Move best;
+	Move ponder;
+	Value score;
+	int depth;
+	std::uint64_t nodes;
+};
+
+// 搜索结果的输出格式，由各个协议实现
+class OutputSearch
+{
+public:
+	virtual ~OutputSearch() {}
+
+	virtual std::string Info(const SearchInfo& info) const = 0;
+	virtual std::string CurrMove(Move move, int number) const = 0;
+	// 没有合法走法时best是空走法，draw表示接受对方的提和
+	virtual std::string BestMove(Move best, Move ponder, bool draw) const = 0;
+};
+
+class SearchWorker;
+class TranspositionTable;
+class ThreadBudget;
+class EvalHash;
+
+// 多线程搜索（Lazy SMP），各线程共享置换表，其它的状态都在自己的工作区里
+// 0号线程负责时间控制和输出，其它线程只是帮忙往置换表里填结果
+class Search
+{
+public:
+	Search(AsyncOutput& output, TranspositionTable& tt);
+	~Search();
+	Search(const Search&) = delete;
+	Search(Search&&) = delete;
+	Search& operator=(const Search&) = delete;
+	Search& operator=(Search&&) = delete;
+
+	// 重新创建搜索线程和工作区，会先等待当前的搜索结束
+	void SetThreads(std::size_t count);
+	std::size_t ThreadCount() const noexcept { return m_workers.size(); }
+	// 和其它搜索共用核心时，每次搜索实际用的线程数由预算决定，不超过ThreadCount
+	// 有预算时SetThreads最多创建预算总核数那么多线程，要在SetThreads之前设置
+	void SetThreadBudget(ThreadBudget* budget) noexcept { m_budget = budget; }
+
+	// 在后台线程开始搜索，结束时输出bestmove
+	void Start(const Position& pos, const SearchLimits& limits, const OutputSearch& output_format);
+	// 在当前线程上搜索并直接返回结果，不输出任何信息，只用到一个线程的工作区
+	// 给批量计算用，搜索一般用depth或者nodes限制
+	SearchResult SearchNow(const Position& pos, const SearchLimits& limits);
+	void Stop() noexcept;
+	// 等待搜索线程结束
+	void Wait();
+	// 清空各线程的历史表
+	void Clear();
+	// 确定性模式：不看时间，只按节点数停止，各线程按固定顺序轮流搜索
+	// 每次搜索前清空置换表和历史表，相同的局面和节点数总是得到相同的结果
+	void SetDeterministic(bool deterministic) noexcept { m_deterministic = deterministic; }
+	// 走子之前先预取子节点的置换表项
+	void SetPrefetch(bool prefetch) noexcept { m_prefetch = prefetch; }
+	// 各线程共用的静态评估缓存，空的或者没有启用时每次都重新评估
+	void SetEvalHash(EvalHash* eval_hash) noexcept { m_eval_hash = eval_hash; }
+	// 每次搜索输出bestmove以后把时间线写到这个文件，空的话不写，需要用CARP_ENABLE_TRACE编译
+	void SetTraceFile(std::string path);
+
+	// 各线程搜索统计的汇总，搜索进行中也可以调用，重置只影响之后的报告
+	std::string GetStatsReport() const;
+	void ResetStats() noexcept;
+
+private:
+	AsyncOutput& m_output;
+	TranspositionTable& m_tt;
+	std::vector<std::unique_ptr<SearchWorker>> m_workers;
+	ThreadBudget* m_budget = nullptr;
+	EvalHash* m_eval_hash = nullptr;
+	// 本次搜索参与的线程数，前m_active_threads个线程
+	std::size_t m_active_threads = 0;
+	std::atomic<bool> m_stop{ false };
+	bool m_deterministic = false;
+	bool m_prefetch = true;
+	std::string m_trace_file;
+	// 外部调用了Stop，和m_stop的区别是搜索自己结束时不会设置，infinite模式要等这个
+	bool m_stop_requested = false;
+	std::mutex m_stop_mutex;
+	std::condition_variable m_stop_cv;
+
+	// 本次搜索的参数，搜索期间只读
+	SearchLimits m_limits;
+	const OutputSearch* m_output_format = nullptr;
+	// 根节点允许的走法，空的话不限制
+	std::vector<Move> m_root_moves;
+	std::chrono::steady_clock::time_point m_start_time;
+	// 超过soft就不开始新的迭代，超过hard立刻停止，0表示不限制
+	std::int64_t m_soft_limit = 0;
+	std::int64_t m_hard_limit = 0;
+
+	void InitTimeLimits();
+	void InitRootMoves(const Position& pos);
+	void WaitForStopRequest();
+	// 主线程搜索结束时把线程还给预算，并告诉置换表这次搜索结束了
+	void EndSearch() noexcept;
+	void DumpTrace() const;
+	std::int64_t Elapsed() const noexcept;
+	std::uint64_t TotalNodes() const noexcept;
+
+	friend class SearchWorker;
+};
+
+} // namespace Carp
@@ -0,0 +1,35 @@
+#include "search_arena.h"
+
+namespace Carp
+{
+
+void SearchArena::ResetForSearch() noexcept
+{
+	nodes.store(0, std::memory_order_relaxed);
+	// 空格子那一行的续着历史永远不更新，当哨兵用
+	auto* const sentinel = &cont_history[PieceIndex(PlayerPieceType::None)][0];
+	for (auto& ss : stack)
+	{
+		ss.pv_length = 0;
+		ss.killers = {};
+		ss.current_move = Move{};
+		ss.excluded_move = Move{};
+		ss.static_eval = VALUE_DRAW;
+		ss.cont_history = sentinel;
+	}
+}
+
+void SearchArena::Clear() noexcept
+{
+	for (auto& row : main_history)
+		row.fill(0);
+	for (auto& piece_to : cont_history)
+		for (auto& history : piece_to)
+			for (auto& row : history)
+				row.fill(0);
+	for (auto& row : correction_history)
+		row.fill(0);
+	ResetForSearch();
+}
+
+} // namespace Carp
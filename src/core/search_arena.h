@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include "def.h"
+#include "move.h"
+#include "stats.h"
+
+namespace Carp
+{
+
+// 历史分数的更新，越接近上限加得越少，不会越界
+template <int LIMIT>
+constexpr void UpdateHistory(std::int16_t& entry, int bonus) noexcept
+{
+	const int clamped = bonus < -LIMIT ? -LIMIT : bonus > LIMIT ? LIMIT : bonus;
+	entry = static_cast<std::int16_t>(entry + clamped - entry * std::abs(clamped) / LIMIT);
+}
+
+constexpr int HISTORY_LIMIT = 16384;
+constexpr int CORRECTION_HISTORY_LIMIT = 1024;
+constexpr std::size_t CORRECTION_HISTORY_SIZE = 16384;
+
+// 按 [棋子][目标格] 记录的历史分数
+using PieceToHistory = std::array<std::array<std::int16_t, SQUARE_NB>, PLAYER_PIECE_NB>;
+// 不吃子走法的历史分数
+using ButterflyHistory = PieceToHistory;
+// 按前面某一步的 [棋子][目标格] 索引的历史分数
+using ContinuationHistory = std::array<std::array<PieceToHistory, SQUARE_NB>, PLAYER_PIECE_NB>;
+// 静态评估和搜索结果的差，按兵卒结构统计
+using CorrectionHistory = std::array<std::array<std::int16_t, CORRECTION_HISTORY_SIZE>, PLAYER_NB>;
+
+// 每一层搜索用到的状态
+struct SearchStack
+{
+	std::array<Move, MAX_PLY + 1> pv;
+	int pv_length;
+	std::array<Move, 2> killers;
+	Move current_move;
+	// 奇异延伸的验证搜索时要排除的走法，平时是空走法
+	Move excluded_move;
+	Value static_eval;
+	// 这一层走的棋对应的续着历史，下面两层排序时用
+	PieceToHistory* cont_history;
+};
+
+// 根节点前面留两层哨兵，搜索时访问ss - 1、ss - 2不用判断越界
+constexpr int STACK_OFFSET = 2;
+
+// 每个搜索线程独占的工作区，线程数变化时分配一次，之后只重置
+// 按缓存行对齐，各线程频繁写的计数不会落在同一个缓存行里
+struct alignas(CACHE_LINE_SIZE) SearchArena
+{
+	// 只有所属线程写，其它线程读出来汇总
+	std::atomic<std::uint64_t> nodes{ 0 };
+	SearchStats stats;
+	// stats reset时记下的值，报告的是stats减去它，搜索中途重置也不用改搜索线程在写的计数
+	SearchStats stats_base;
+
+	std::array<SearchStack, MAX_PLY + STACK_OFFSET + 1> stack;
+	ButterflyHistory main_history;
+	ContinuationHistory cont_history;
+	CorrectionHistory correction_history;
+
+	SearchStack* Root() noexcept { return &stack[STACK_OFFSET]; }
+
+	// 每次搜索开始时调用，只重置搜索栈，历史表保留到下一次搜索
+	void ResetForSearch() noexcept;
+	// 新对局或者清空置换表时调用
+	void Clear() noexcept;
+};
+
+} // namespace Carp
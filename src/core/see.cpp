@@ -0,0 +1,80 @@
+#include "see.h"
+#include "position.h"
+#include "evaluate.h"
+#include "utils/cpu.h"
+
+namespace Carp
+{
+
+// 帅的价值在交换里当成无穷大，只有对方没有攻击的时候才能用它吃
+constexpr Value SEE_KING_VALUE = 10000;
+
+// 按价值从低到高的顺序选攻击者
+constexpr std::array<PieceType, PIECE_TYPE_NB> SEE_ORDER = {
+	PieceType::Pawn, PieceType::Advisor, PieceType::Elephant, PieceType::Knight,
+	PieceType::Cannon, PieceType::Rook, PieceType::King,
+};
+
+static Value SeeValue(PlayerPieceType player_piece) noexcept
+{
+	if (player_piece == PlayerPieceType::None)
+		return 0;
+	const auto piece = DeComposePlayerPiece(player_piece).second;
+	return piece == PieceType::King ? SEE_KING_VALUE : PieceValue(piece);
+}
+
+CARP_CPU_DISPATCH bool SeeGe(const Position& pos, Move move, Value threshold) noexcept
+{
+	const auto from = move.From();
+	const auto to = move.To();
+
+	Value swap = SeeValue(pos.PieceOn(to)) - threshold;
+	if (swap < 0)
+		return false;
+
+	swap = SeeValue(pos.PieceOn(from)) - swap;
+	if (swap <= 0)
+		return true;
+
+	auto occupied = pos.Occupied() ^ from;
+	auto player = pos.SideToMove();
+	bool res = true;
+
+	while (true)
+	{
+		player = Opponent(player);
+		// 炮和马的攻击都和占位有关，每次都重新算
+		const auto attackers = pos.AttackersTo(to, player, occupied) & occupied;
+		if (!attackers)
+			break;
+
+		res = !res;
+
+		PieceType attacker_type = PieceType::King;
+		Bitboard attacker_bb;
+		for (auto piece : SEE_ORDER)
+		{
+			attacker_bb = attackers & pos.Pieces(player, piece);
+			if (attacker_bb)
+			{
+				attacker_type = piece;
+				break;
+			}
+		}
+
+		if (attacker_type == PieceType::King)
+		{
+			// 用帅吃的时候，如果对方还有攻击，这步就吃不了，结果反过来
+			const auto opp_attackers = pos.AttackersTo(to, Opponent(player), occupied) & occupied;
+			return opp_attackers ? !res : res;
+		}
+
+		swap = PieceValue(attacker_type) - swap;
+		if (swap < static_cast<Value>(res))
+			break;
+		occupied ^= attacker_bb.Lsb();
+	}
+	return res;
+}
+
+} // namespace Carp
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "def.h"
+#include "move.h"
+
+namespace Carp
+{
+
+class Position;
+
+// 静态交换评估，判断这步棋在交换完之后是否至少能得到threshold的分数
+// 每换一次子都会按新的占位重新算攻击，炮架和马腿的变化都能考虑到
+bool SeeGe(const Position& pos, Move move, Value threshold) noexcept;
+
+} // namespace Carp
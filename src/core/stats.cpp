@@ -0,0 +1,101 @@
+#include "stats.h"
+#include <iomanip>
+#include <sstream>
+
+namespace Carp
+{
+
+SearchStats& SearchStats::operator+=(const SearchStats& other) noexcept
+{
+	nodes += other.nodes;
+	qnodes += other.qnodes;
+	tt_probes += other.tt_probes;
+	tt_hits += other.tt_hits;
+	tt_probe_ns += other.tt_probe_ns;
+	tt_prefetches += other.tt_prefetches;
+	cutoffs += other.cutoffs;
+	first_move_cutoffs += other.first_move_cutoffs;
+	null_tries += other.null_tries;
+	null_cutoffs += other.null_cutoffs;
+	lmr_searches += other.lmr_searches;
+	lmr_researches += other.lmr_researches;
+	singular_tests += other.singular_tests;
+	singular_extensions += other.singular_extensions;
+	multi_cuts += other.multi_cuts;
+	movegen_calls += other.movegen_calls;
+	movegen_ns += other.movegen_ns;
+	eval_calls += other.eval_calls;
+	eval_ns += other.eval_ns;
+	eval_hash_hits += other.eval_hash_hits;
+	return *this;
+}
+
+SearchStats& SearchStats::operator-=(const SearchStats& other) noexcept
+{
+	nodes -= other.nodes;
+	qnodes -= other.qnodes;
+	tt_probes -= other.tt_probes;
+	tt_hits -= other.tt_hits;
+	tt_probe_ns -= other.tt_probe_ns;
+	tt_prefetches -= other.tt_prefetches;
+	cutoffs -= other.cutoffs;
+	first_move_cutoffs -= other.first_move_cutoffs;
+	null_tries -= other.null_tries;
+	null_cutoffs -= other.null_cutoffs;
+	lmr_searches -= other.lmr_searches;
+	lmr_researches -= other.lmr_researches;
+	singular_tests -= other.singular_tests;
+	singular_extensions -= other.singular_extensions;
+	multi_cuts -= other.multi_cuts;
+	movegen_calls -= other.movegen_calls;
+	movegen_ns -= other.movegen_ns;
+	eval_calls -= other.eval_calls;
+	eval_ns -= other.eval_ns;
+	eval_hash_hits -= other.eval_hash_hits;
+	return *this;
+}
+
+static double Percent(std::uint64_t part, std::uint64_t total) noexcept
+{
+	return total == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(total);
+}
+
+static double Average(std::uint64_t sum, std::uint64_t count) noexcept
+{
+	return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+std::string FormatStats(std::span<const SearchStats> stats)
+{
+	if constexpr (!STATS_ENABLED)
+		return "info string stats disabled, rebuild with -DCARP_ENABLE_STATS=ON";
+
+	SearchStats total;
+	for (const auto& thread_stats : stats)
+		total += thread_stats;
+	std::ostringstream os;
+	os << std::fixed << std::setprecision(1);
+	os << "info string threads " << stats.size() << " nodes " << total.nodes
+		<< " qnodes " << total.qnodes << " (" << Percent(total.qnodes, total.nodes) << "%)\n";
+	os << "info string tt probes " << total.tt_probes << " hits " << total.tt_hits
+		<< " (" << Percent(total.tt_hits, total.tt_probes) << "%)\n";
+	// 读置换表的平均耗时，和关掉TT Prefetch时比较就能看出预取省了多少等待
+	os << "info string tt probe avg " << Average(total.tt_probe_ns, total.tt_probes) << " ns prefetches "
+		<< total.tt_prefetches << " (" << Percent(total.tt_prefetches, total.tt_probes) << "% of probes)\n";
+	os << "info string cutoffs " << total.cutoffs << " first move " << total.first_move_cutoffs
+		<< " (" << Percent(total.first_move_cutoffs, total.cutoffs) << "%)\n";
+	os << "info string null move tries " << total.null_tries << " cutoffs " << total.null_cutoffs
+		<< " (" << Percent(total.null_cutoffs, total.null_tries) << "%)\n";
+	os << "info string lmr searches " << total.lmr_searches << " re-searches " << total.lmr_researches
+		<< " (" << Percent(total.lmr_researches, total.lmr_searches) << "%)\n";
+	os << "info string singular tests " << total.singular_tests << " extended " << total.singular_extensions
+		<< " (" << Percent(total.singular_extensions, total.singular_tests) << "%) multi-cuts " << total.multi_cuts << "\n";
+	os << "info string movegen calls " << total.movegen_calls
+		<< " avg " << Average(total.movegen_ns, total.movegen_calls) << " ns\n";
+	os << "info string eval calls " << total.eval_calls
+		<< " avg " << Average(total.eval_ns, total.eval_calls) << " ns eval hash hits " << total.eval_hash_hits
+		<< " (" << Percent(total.eval_hash_hits, total.eval_calls) << "%)";
+	return os.str();
+}
+
+} // namespace Carp
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <span>
+#include "utils/spsc_queue.h"
+
+namespace Carp
+{
+
+// 一个统计项，只有所属的搜索线程写，别的线程（stats命令）随时可以读
+// 只有一个写者，所以加法用relaxed的读和写就够了，不用原子加法
+class StatsCounter
+{
+public:
+	StatsCounter() noexcept = default;
+	StatsCounter(const StatsCounter& other) noexcept : m_value(other.Get()) {}
+	StatsCounter& operator=(const StatsCounter& other) noexcept
+	{
+		m_value.store(other.Get(), std::memory_order_relaxed);
+		return *this;
+	}
+
+	std::uint64_t Get() const noexcept { return m_value.load(std::memory_order_relaxed); }
+	operator std::uint64_t() const noexcept { return Get(); }
+
+	StatsCounter& operator+=(std::uint64_t value) noexcept
+	{
+		m_value.store(Get() + value, std::memory_order_relaxed);
+		return *this;
+	}
+	StatsCounter& operator-=(std::uint64_t value) noexcept
+	{
+		m_value.store(Get() - value, std::memory_order_relaxed);
+		return *this;
+	}
+	StatsCounter& operator++() noexcept { return *this += 1; }
+
+private:
+	std::atomic<std::uint64_t> m_value{ 0 };
+};
+
+// 搜索统计，每个搜索线程一份，按缓存行对齐避免线程之间伪共享
+// 只有定义了CARP_STATS（CMake选项CARP_ENABLE_STATS）才会真正计数，否则下面的宏全是空的
+struct alignas(CACHE_LINE_SIZE) SearchStats
+{
+	StatsCounter nodes;
+	StatsCounter qnodes;
+	StatsCounter tt_probes;
+	StatsCounter tt_hits;
+	StatsCounter tt_probe_ns;
+	StatsCounter tt_prefetches;
+	StatsCounter cutoffs;
+	StatsCounter first_move_cutoffs;
+	StatsCounter null_tries;
+	StatsCounter null_cutoffs;
+	StatsCounter lmr_searches;
+	StatsCounter lmr_researches;
+	StatsCounter singular_tests;
+	StatsCounter singular_extensions;
+	StatsCounter multi_cuts;
+	StatsCounter movegen_calls;
+	StatsCounter movegen_ns;
+	StatsCounter eval_calls;
+	StatsCounter eval_ns;
+	StatsCounter eval_hash_hits;
+
+	SearchStats& operator+=(const SearchStats& other) noexcept;
+	SearchStats& operator-=(const SearchStats& other) noexcept;
+};
+
+// 把各线程的统计加起来，输出成info string的格式
+std::string FormatStats(std::span<const SearchStats> stats);
+
+#ifdef CARP_STATS
+constexpr bool STATS_ENABLED = true;
+
+// 计时并把耗时加到指定的统计项上
+class ScopedStatsTimer
+{
+public:
+	explicit ScopedStatsTimer(StatsCounter& counter) noexcept :
+		m_counter(counter), m_start(std::chrono::steady_clock::now()) {}
+	~ScopedStatsTimer()
+	{
+		auto duration = std::chrono::steady_clock::now() - m_start;
+		m_counter += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+	ScopedStatsTimer(const ScopedStatsTimer&) = delete;
+	ScopedStatsTimer& operator=(const ScopedStatsTimer&) = delete;
+
+private:
+	StatsCounter& m_counter;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+#define CARP_STATS_CONCAT_IMPL(a, b) a##b
+#define CARP_STATS_CONCAT(a, b) CARP_STATS_CONCAT_IMPL(a, b)
+#define CARP_STATS_INC(stats, field) (++(stats).field)
+#define CARP_STATS_ADD(stats, field, value) ((stats).field += (value))
+#define CARP_STATS_TIMER(stats, field) ::Carp::ScopedStatsTimer CARP_STATS_CONCAT(_carp_stats_timer_, __LINE__){ (stats).field }
+#else // !CARP_STATS
+constexpr bool STATS_ENABLED = false;
+
+#define CARP_STATS_INC(stats, field) ((void)0)
+#define CARP_STATS_ADD(stats, field, value) ((void)0)
+#define CARP_STATS_TIMER(stats, field) ((void)0)
+#endif // CARP_STATS
+
+} // namespace Carp
@@ -0,0 +1,212 @@
+#include "tactics.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include "position.h"
+#include "search.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+std::string_view Trim(std::string_view str) noexcept
+{
+	const auto begin = str.find_first_not_of(" \t\r\n");
+	if (begin == std::string_view::npos)
+		return {};
+	return str.substr(begin, str.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// FEN后面可选的字段："-"或者回合数
+bool IsFenTail(std::string_view token) noexcept
+{
+	return token == "-" || std::ranges::all_of(token, [](unsigned char c) { return std::isdigit(c); });
+}
+
+TacticsPosition ParseEpdLine(std::string_view line)
+{
+	TacticsPosition position;
+	std::istringstream ss{ std::string{ line } };
+	std::string board;
+	std::string side;
+	ss >> board >> side;
+	position.fen = board + ' ' + side;
+
+	std::string token;
+	while (ss >> token && IsFenTail(token))
+		position.fen += ' ' + token;
+	std::string operations = token;
+	std::string rest;
+	std::getline(ss, rest);
+	operations += rest;
+
+	// 操作之间用分号隔开，每个操作是"<名字> <参数>..."
+	std::string_view ops = operations;
+	while (!ops.empty())
+	{
+		const auto semicolon = ops.find(';');
+		const auto op = Trim(ops.substr(0, semicolon));
+		ops = semicolon == std::string_view::npos ? std::string_view{} : ops.substr(semicolon + 1);
+		if (op.empty())
+			continue;
+
+		const auto space = op.find(' ');
+		const auto name = op.substr(0, space);
+		const auto args = space == std::string_view::npos ? std::string_view{} : Trim(op.substr(space + 1));
+		if (name == "id")
+		{
+			position.id = args.size() >= 2 && args.front() == '"' && args.back() == '"' ? args.substr(1, args.size() - 2) : args;
+			continue;
+		}
+		if (name != "bm" && name != "am")
+			continue;
+		auto& moves = name == "bm" ? position.best_moves : position.avoid_moves;
+		std::istringstream move_ss{ std::string{ args } };
+		while (move_ss >> token)
+		{
+			const auto move = Move::FromString(token);
+			if (!move)
+			{
+				position.error = "invalid move " + token;
+				break;
+			}
+			moves.push_back(move);
+		}
+	}
+	if (position.error.empty() && position.best_moves.empty() && position.avoid_moves.empty())
+		position.error = "no bm or am";
+	return position;
+}
+
+// 转发给协议的输出格式，同时记下每次迭代的主要变例第一步是不是答案
+class TacticsOutput : public OutputSearch
+{
+public:
+	TacticsOutput(const TacticsPosition& position, const OutputSearch& format) :
+		m_position(position), m_format(format) {}
+
+	std::string Info(const SearchInfo& info) const override
+	{
+		m_nodes = info.nodes;
+		if (info.pv.empty() || !IsSolution(info.pv.front()))
+			m_solve_time = -1;
+		else if (m_solve_time < 0)
+			m_solve_time = info.time;
+		return m_format.Info(info);
+	}
+
+	std::string CurrMove(Move move, int number) const override { return m_format.CurrMove(move, number); }
+
+	// 不输出bestmove，结果最后一起报告
+	std::string BestMove(Move best, [[maybe_unused]] Move ponder, [[maybe_unused]] bool draw) const override
+	{
+		m_best = best;
+		return "";
+	}
+
+	bool IsSolution(Move move) const noexcept
+	{
+		if (!m_position.best_moves.empty())
+			return std::ranges::find(m_position.best_moves, move) != m_position.best_moves.end();
+		return std::ranges::find(m_position.avoid_moves, move) == m_position.avoid_moves.end();
+	}
+
+	Move Best() const noexcept { return m_best; }
+	std::int64_t SolveTime() const noexcept { return m_solve_time; }
+	std::uint64_t Nodes() const noexcept { return m_nodes; }
+
+private:
+	const TacticsPosition& m_position;
+	const OutputSearch& m_format;
+	// 输出格式的接口是const的，搜索过程中的记录只能是mutable，都只在0号线程上改
+	mutable Move m_best;
+	mutable std::int64_t m_solve_time = -1;
+	mutable std::uint64_t m_nodes = 0;
+};
+
+} // namespace
+
+std::vector<TacticsPosition> ReadTactics(std::istream& in)
+{
+	std::vector<TacticsPosition> positions;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		const auto trimmed = Trim(line);
+		if (trimmed.empty() || trimmed.front() == '#')
+			continue;
+		auto& position = positions.emplace_back(ParseEpdLine(trimmed));
+		if (position.id.empty())
+			position.id = std::to_string(positions.size());
+	}
+	return positions;
+}
+
+std::vector<TacticsResult> RunTactics(Search& search, const std::vector<TacticsPosition>& positions,
+	const SearchLimits& limits, const OutputSearch& format)
+{
+	// 一题搜完才能开始下一题，不能等stop
+	auto search_limits = limits;
+	search_limits.infinite = false;
+
+	std::vector<TacticsResult> results;
+	results.reserve(positions.size());
+	for (const auto& position : positions)
+	{
+		auto& result = results.emplace_back();
+		result.id = position.id;
+		if (!position.error.empty())
+		{
+			result.error = position.error;
+			continue;
+		}
+		Position pos;
+		if (!pos.SetFen(position.fen))
+		{
+			result.error = "invalid fen";
+			continue;
+		}
+
+		const TacticsOutput output{ position, format };
+		search.Start(pos, search_limits, output);
+		search.Wait();
+		result.best = output.Best();
+		result.nodes = output.Nodes();
+		// 最后选的走法不是答案的话，中间找到过也不算
+		result.solved = result.best && output.IsSolution(result.best);
+		result.solve_time = result.solved ? std::max<std::int64_t>(output.SolveTime(), 0) : -1;
+	}
+	return results;
+}
+
+std::string FormatTacticsResults(const std::vector<TacticsResult>& results, std::string_view prefix)
+{
+	std::ostringstream ss;
+	std::size_t solved = 0;
+	std::int64_t total_time = 0;
+	std::uint64_t total_nodes = 0;
+	for (const auto& result : results)
+	{
+		ss << prefix << result.id;
+		if (!result.error.empty())
+			ss << " error " << result.error;
+		else
+		{
+			ss << (result.solved ? " solved" : " failed") << " time " << result.solve_time
+				<< " best " << (result.best ? result.best.ToString() : "(none)") << " nodes " << result.nodes;
+		}
+		ss << '\n';
+		if (result.solved)
+		{
+			solved++;
+			total_time += result.solve_time;
+		}
+		total_nodes += result.nodes;
+	}
+	ss << prefix << "solved " << solved << '/' << results.size() << " time " << total_time << " nodes " << total_nodes;
+	return ss.str();
+}
+
+} // namespace Carp
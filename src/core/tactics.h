@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "move.h"
+
+namespace Carp
+{
+
+class Search;
+class OutputSearch;
+struct SearchLimits;
+
+// go tactics没有给出限制时每个局面搜索的时间，毫秒
+constexpr std::int64_t DEFAULT_TACTICS_MOVE_TIME = 5000;
+
+// EPD里的一道题："<FEN> bm <走法>...; am <走法>...; id "<名字>";"，走法是ICCS坐标
+struct TacticsPosition
+{
+	std::string fen;
+	// 最好的走法，走其中任何一个都算解出
+	std::vector<Move> best_moves;
+	// 要避免的走法，没有bm时不走这些就算解出
+	std::vector<Move> avoid_moves;
+	std::string id;
+	// 读题时出错的原因，出错的题不搜索，算没有解出
+	std::string error;
+};
+
+struct TacticsResult
+{
+	std::string id;
+	Move best;
+	bool solved = false;
+	// 从这个时间开始主要变例的第一步一直是答案，没有解出时是-1
+	std::int64_t solve_time = -1;
+	std::uint64_t nodes = 0;
+	std::string error;
+};
+
+std::vector<TacticsPosition> ReadTactics(std::istream& in);
+
+// 用search逐题正常搜索（多线程、时间控制和go一样），每次迭代的info照常用format输出，
+// 根据每次迭代的主要变例记录解出的时间
+std::vector<TacticsResult> RunTactics(Search& search, const std::vector<TacticsPosition>& positions,
+	const SearchLimits& limits, const OutputSearch& format);
+
+// 每题一行"<id> solved|failed time <毫秒> best <走法> nodes <n>"，最后一行是汇总，每行前面加上prefix
+std::string FormatTacticsResults(const std::vector<TacticsResult>& results, std::string_view prefix);
+
+} // namespace Carp
@@ -0,0 +1,30 @@
+#include "thread_budget.h"
+#include <algorithm>
+
+namespace Carp
+{
+
+ThreadBudget::ThreadBudget(std::size_t cores) noexcept :
+	m_cores(std::max<std::size_t>(cores, 1)) {}
+
+std::size_t ThreadBudget::Acquire(std::size_t requested)
+{
+	std::lock_guard lock(m_mutex);
+	// 已经在跑的搜索不会缩减线程，新来的最多拿平分后的那一份和剩下的空闲核心
+	const auto share = std::max<std::size_t>(m_cores / (m_searches + 1), 1);
+	const auto idle = m_cores > m_in_use ? m_cores - m_in_use : 0;
+	const auto granted = std::max<std::size_t>(std::min({ requested, share, idle }), 1);
+	m_in_use += granted;
+	m_searches++;
+	return granted;
+}
+
+void ThreadBudget::Release(std::size_t count)
+{
+	std::lock_guard lock(m_mutex);
+	m_in_use -= std::min(count, m_in_use);
+	if (m_searches > 0)
+		m_searches--;
+}
+
+} // namespace Carp
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+
+namespace Carp
+{
+
+// 多个搜索共用一组CPU核心（服务器模式下每个会话一个搜索）
+// 每次搜索开始时按当前正在搜索的数量平分核心，至少给一个线程
+class ThreadBudget
+{
+public:
+	explicit ThreadBudget(std::size_t cores) noexcept;
+	ThreadBudget(const ThreadBudget&) = delete;
+	ThreadBudget& operator=(const ThreadBudget&) = delete;
+
+	// 申请最多requested个线程，返回实际能用的数量，用完要Release
+	std::size_t Acquire(std::size_t requested);
+	void Release(std::size_t count);
+
+	std::size_t Cores() const noexcept { return m_cores; }
+
+private:
+	std::mutex m_mutex;
+	const std::size_t m_cores;
+	std::size_t m_in_use = 0;
+	std::size_t m_searches = 0;
+};
+
+} // namespace Carp
@@ -0,0 +1,194 @@
+#include "tt.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include "utils/block_file.h"
+#include "utils/trace.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+// 置换表文件的头，单独占第一个块，后面是所有的桶，按本机的字节序保存
+struct TTFileHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t cluster_size;
+	std::uint64_t cluster_count;
+	std::uint8_t generation;
+};
+
+constexpr char TT_FILE_MAGIC[8] = { 'C', 'A', 'R', 'P', 'H', 'A', 'S', 'H' };
+// 桶的格式变了就要改版本号
+constexpr std::uint32_t TT_FILE_VERSION = 1;
+
+static_assert(sizeof(TTFileHeader) <= BlockFile::ALIGNMENT);
+
+} // namespace
+
+void TTEntry::Save(std::uint64_t key, Value value, Bound bound, int depth, Move move, Value eval, std::uint8_t generation) noexcept
+{
+	const auto key16 = static_cast<std::uint16_t>(key >> 48);
+	// 没有走法时保留原来的走法
+	if (move || key16 != m_key16)
+		m_move = move;
+
+	// 深度差不多的时候新的结果更有价值
+	if (bound == Bound::Exact || key16 != m_key16 || depth + 4 > m_depth
+		|| (m_gen_bound & ~BOUND_MASK) != generation)
+	{
+		m_key16 = key16;
+		m_value = static_cast<std::int16_t>(value);
+		m_eval = static_cast<std::int16_t>(eval);
+		m_depth = static_cast<std::uint8_t>(std::clamp(depth, 0, 255));
+		m_gen_bound = static_cast<std::uint8_t>(generation | static_cast<std::uint8_t>(bound));
+	}
+}
+
+bool TranspositionTable::Resize(std::size_t mb)
+{
+	CARP_TRACE_SCOPE("tt", "resize", static_cast<std::int64_t>(mb));
+	const std::size_t cluster_count = std::max<std::size_t>(mb * 1024 * 1024 / sizeof(TTCluster), 1);
+	std::unique_ptr<TTCluster[]> table{ new (std::nothrow) TTCluster[cluster_count] };
+	if (table == nullptr)
+		return false;
+
+	m_table = std::move(table);
+	m_cluster_count = cluster_count;
+	Clear();
+	return true;
+}
+
+void TranspositionTable::Clear() noexcept
+{
+	CARP_TRACE_SCOPE("tt", "clear");
+	if (m_table != nullptr)
+		std::memset(static_cast<void*>(m_table.get()), 0, m_cluster_count * sizeof(TTCluster));
+	m_generation.store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTable::BeginSearch() noexcept
+{
+	if (m_searches.fetch_add(1, std::memory_order_relaxed) == 0)
+		NewSearch();
+}
+
+TTEntry* TranspositionTable::Probe(std::uint64_t key, bool& found) const noexcept
+{
+	auto* const entries = FirstCluster(key)->entries;
+	const auto key16 = static_cast<std::uint16_t>(key >> 48);
+	const auto generation = Generation();
+
+	for (std::size_t i = 0; i < TTCluster::ENTRY_COUNT; i++)
+	{
+		if (entries[i].m_key16 == key16 || entries[i].m_depth == 0)
+		{
+			// 顺便更新代数，避免被当成旧的项替换掉
+			entries[i].m_gen_bound = static_cast<std::uint8_t>(generation | (entries[i].m_gen_bound & TTEntry::BOUND_MASK));
+			found = entries[i].m_key16 == key16 && entries[i].GetBound() != Bound::None;
+			return &entries[i];
+		}
+	}
+
+	// 替换深度最浅、最旧的那一项
+	auto replace_score = [generation](const TTEntry& entry) {
+		const int age = (TTEntry::GENERATION_CYCLE + generation - entry.m_gen_bound) & (TTEntry::GENERATION_CYCLE - 1) & ~TTEntry::BOUND_MASK;
+		return entry.m_depth - age * 2;
+	};
+	auto* replace = &entries[0];
+	for (std::size_t i = 1; i < TTCluster::ENTRY_COUNT; i++)
+	{
+		if (replace_score(entries[i]) < replace_score(*replace))
+			replace = &entries[i];
+	}
+	found = false;
+	return replace;
+}
+
+int TranspositionTable::Hashfull() const noexcept
+{
+	constexpr std::size_t SAMPLE_CLUSTERS = 1000 / TTCluster::ENTRY_COUNT;
+	const auto sample = std::min(SAMPLE_CLUSTERS, m_cluster_count);
+	const auto generation = Generation();
+	int count = 0;
+	for (std::size_t i = 0; i < sample; i++)
+	{
+		for (const auto& entry : m_table[i].entries)
+		{
+			if (entry.GetBound() != Bound::None && (entry.m_gen_bound & ~TTEntry::BOUND_MASK) == generation)
+				count++;
+		}
+	}
+	return sample == 0 ? 0 : static_cast<int>(count * 1000 / (sample * TTCluster::ENTRY_COUNT));
+}
+
+bool TranspositionTable::Save(const std::string& path, bool direct, std::string& error) const
+{
+	BlockFile file;
+	if (!file.OpenWrite(path, direct))
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	alignas(BlockFile::ALIGNMENT) std::byte block[BlockFile::ALIGNMENT]{};
+	TTFileHeader header{};
+	std::memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+	header.version = TT_FILE_VERSION;
+	header.cluster_size = sizeof(TTCluster);
+	header.cluster_count = m_cluster_count;
+	header.generation = Generation();
+	std::memcpy(block, &header, sizeof(header));
+	if (!file.Write(block, sizeof(block)) || !file.Write(m_table.get(), m_cluster_count * sizeof(TTCluster)))
+	{
+		error = "write failed";
+		return false;
+	}
+	return true;
+}
+
+bool TranspositionTable::Load(const std::string& path, bool direct, std::string& error)
+{
+	BlockFile file;
+	if (!file.OpenRead(path, direct))
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+	alignas(BlockFile::ALIGNMENT) std::byte block[BlockFile::ALIGNMENT]{};
+	TTFileHeader header{};
+	if (!file.Read(block, sizeof(block)))
+	{
+		error = "file too short";
+		return false;
+	}
+	std::memcpy(&header, block, sizeof(header));
+	if (std::memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) != 0)
+	{
+		error = "not a hash file";
+		return false;
+	}
+	if (header.version != TT_FILE_VERSION || header.cluster_size != sizeof(TTCluster))
+	{
+		error = "unsupported hash file version " + std::to_string(header.version);
+		return false;
+	}
+	if (header.cluster_count != m_cluster_count)
+	{
+		error = "hash file is " + std::to_string(header.cluster_count * sizeof(TTCluster) / (1024 * 1024))
+			+ " MB, set Hash to the same size first";
+		return false;
+	}
+	if (!file.Read(m_table.get(), m_cluster_count * sizeof(TTCluster)))
+	{
+		Clear();
+		error = "read failed";
+		return false;
+	}
+	m_generation.store(header.generation, std::memory_order_relaxed);
+	return true;
+}
+
+} // namespace Carp
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "def.h"
+#include "move.h"
+
+namespace Carp
+{
+
+enum class Bound : std::uint8_t
+{
+	None = 0,
+	Upper = 1,
+	Lower = 2,
+	Exact = Upper | Lower,
+};
+
+// 置换表的一项，一共10字节
+struct TTEntry
+{
+	Move GetMove() const noexcept { return m_move; }
+	Value GetValue() const noexcept { return m_value; }
+	Value GetEval() const noexcept { return m_eval; }
+	int GetDepth() const noexcept { return m_depth; }
+	Bound GetBound() const noexcept { return static_cast<Bound>(m_gen_bound & BOUND_MASK); }
+
+	void Save(std::uint64_t key, Value value, Bound bound, int depth, Move move, Value eval, std::uint8_t generation) noexcept;
+
+private:
+	static constexpr std::uint8_t BOUND_MASK = 0x03;
+	// 低两位是Bound，剩下的是代数
+	static constexpr std::uint8_t GENERATION_DELTA = 0x04;
+	static constexpr int GENERATION_CYCLE = 0x100;
+
+	std::uint16_t m_key16;
+	Move m_move;
+	std::int16_t m_value;
+	std::int16_t m_eval;
+	std::uint8_t m_depth;
+	std::uint8_t m_gen_bound;
+
+	friend class TranspositionTable;
+};
+
+static_assert(sizeof(TTEntry) == 10);
+
+// 3项放在一个32字节的桶里，两个桶正好一个缓存行
+struct alignas(32) TTCluster
+{
+	static constexpr std::size_t ENTRY_COUNT = 3;
+
+	TTEntry entries[ENTRY_COUNT];
+	char padding[2];
+};
+
+static_assert(sizeof(TTCluster) == 32);
+
+// 多线程共享，不加锁，读出来的走法在使用前需要检查是否合法
+class TranspositionTable
+{
+public:
+	TranspositionTable() = default;
+	~TranspositionTable() = default;
+	TranspositionTable(const TranspositionTable&) = delete;
+	TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+	// 单位是MB，分配失败时保留原来的表并返回false
+	bool Resize(std::size_t mb);
+	void Clear() noexcept;
+	// 换一代，用来区分旧的项
+	void NewSearch() noexcept { m_generation.fetch_add(TTEntry::GENERATION_DELTA, std::memory_order_relaxed); }
+	std::uint8_t Generation() const noexcept { return m_generation.load(std::memory_order_relaxed); }
+	// 每次搜索开始和结束时调用。多个搜索共用一个表（服务器模式）时，只有没有别的搜索在进行时才换代，
+	// 同时进行的搜索属于同一代，不会互相把对方的项变旧
+	void BeginSearch() noexcept;
+	void EndSearch() noexcept { m_searches.fetch_sub(1, std::memory_order_relaxed); }
+
+	// 找到了返回对应的项，没找到返回可以替换的项
+	TTEntry* Probe(std::uint64_t key, bool& found) const noexcept;
+	// 提前把key所在的桶读进缓存，表很大的时候几乎每次读都要等内存
+	void Prefetch(std::uint64_t key) const noexcept
+	{
+#if defined(__GNUC__)
+		__builtin_prefetch(FirstCluster(key));
+#endif
+	}
+	// 千分之多少的项是这次搜索写入的
+	int Hashfull() const noexcept;
+	std::size_t SizeMB() const noexcept { return m_cluster_count * sizeof(TTCluster) / (1024 * 1024); }
+
+	// 整个表存盘和读盘，文件里的大小要和当前的表一致，direct表示尽量绕过页缓存
+	// 失败时error里是原因，读到一半失败的话表会被清空
+	bool Save(const std::string& path, bool direct, std::string& error) const;
+	bool Load(const std::string& path, bool direct, std::string& error);
+
+private:
+	std::unique_ptr<TTCluster[]> m_table;
+	std::size_t m_cluster_count = 0;
+	std::atomic<std::uint8_t> m_generation{ 0 };
+	// 正在进行的搜索数
+	std::atomic<int> m_searches{ 0 };
+
+	TTCluster* FirstCluster(std::uint64_t key) const noexcept
+	{
+		// 用乘法的高64位代替取模
+#if defined(__SIZEOF_INT128__)
+		const auto index = static_cast<std::size_t>((static_cast<unsigned __int128>(key) * m_cluster_count) >> 64);
+#else
+		const auto index = static_cast<std::size_t>(key % m_cluster_count);
+#endif
+		return &m_table[index];
+	}
+};
+
+// 杀棋分数和层数有关，存进置换表时要换成相对当前节点的分数
+constexpr Value ValueToTT(Value value, int ply) noexcept
+{
+	return value >= VALUE_MATE_IN_MAX_PLY ? value + ply : value <= -VALUE_MATE_IN_MAX_PLY ? value - ply : value;
+}
+
+constexpr Value ValueFromTT(Value value, int ply) noexcept
+{
+	return value >= VALUE_MATE_IN_MAX_PLY ? value - ply : value <= -VALUE_MATE_IN_MAX_PLY ? value + ply : value;
+}
+
+} // namespace Carp
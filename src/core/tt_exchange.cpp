@@ -0,0 +1,97 @@
+#include "tt_exchange.h"
+#include <charconv>
+#include <cstdlib>
+#include <sstream>
+#include "movegen.h"
+#include "position.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+void CollectLine(Position& pos, const TranspositionTable& tt, int plies, std::vector<TTExchangeEntry>& entries)
+{
+	bool found = false;
+	const auto* tte = tt.Probe(pos.Key(), found);
+	if (!found)
+		return;
+	const auto move = tte->GetMove();
+	if (tte->GetDepth() > 0)
+		entries.push_back(TTExchangeEntry{ pos.Key(), move, tte->GetValue(), tte->GetBound(), tte->GetDepth() });
+	if (plies <= 1 || !pos.CanMakeMove() || !IsLegalMove(pos, move))
+		return;
+	pos.MakeMove(move);
+	CollectLine(pos, tt, plies - 1, entries);
+	pos.UnmakeMove();
+}
+
+template <typename T>
+bool ParseField(std::string_view str, T& value, int base = 10) noexcept
+{
+	const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value, base);
+	return ec == std::errc{} && ptr == str.data() + str.size();
+}
+
+} // namespace
+
+std::vector<TTExchangeEntry> CollectTTEntries(Position pos, const TranspositionTable& tt, int max_plies)
+{
+	std::vector<TTExchangeEntry> entries;
+	if (max_plies <= 0)
+		return entries;
+	bool found = false;
+	const auto* tte = tt.Probe(pos.Key(), found);
+	if (found && tte->GetDepth() > 0)
+		entries.push_back(TTExchangeEntry{ pos.Key(), tte->GetMove(), tte->GetValue(), tte->GetBound(), tte->GetDepth() });
+	if (max_plies == 1 || !pos.CanMakeMove())
+		return entries;
+
+	// 根节点的每个走法都要看，这样分给不同进程的走法都能交换到
+	MoveList moves;
+	GenerateLegal<GenType::All>(pos, moves);
+	for (const auto& scored : moves)
+	{
+		pos.MakeMove(scored.move);
+		CollectLine(pos, tt, max_plies - 1, entries);
+		pos.UnmakeMove();
+	}
+	return entries;
+}
+
+void StoreTTEntry(TranspositionTable& tt, const TTExchangeEntry& entry) noexcept
+{
+	bool found = false;
+	auto* const tte = tt.Probe(entry.key, found);
+	if (found && tte->GetDepth() >= entry.depth)
+		return;
+	tte->Save(entry.key, entry.value, entry.bound, entry.depth, entry.move, found ? tte->GetEval() : VALUE_NONE, tt.Generation());
+}
+
+std::string FormatTTEntry(const TTExchangeEntry& entry)
+{
+	std::ostringstream os;
+	os << std::hex << entry.key << std::dec << ' ' << (entry.move ? entry.move.ToString() : "0000") << ' '
+		<< entry.value << ' ' << static_cast<int>(entry.bound) << ' ' << entry.depth;
+	return os.str();
+}
+
+std::optional<TTExchangeEntry> ParseTTEntry(std::span<const std::string_view> fields) noexcept
+{
+	if (fields.size() < 5)
+		return std::nullopt;
+	TTExchangeEntry entry{};
+	int bound = 0;
+	if (!ParseField(fields[0], entry.key, 16) || !ParseField(fields[2], entry.value) || !ParseField(fields[3], bound)
+		|| !ParseField(fields[4], entry.depth))
+		return std::nullopt;
+	if (bound < static_cast<int>(Bound::Upper) || bound > static_cast<int>(Bound::Exact)
+		|| entry.depth <= 0 || entry.depth > 255 || std::abs(entry.value) > VALUE_INFINITE)
+		return std::nullopt;
+	entry.bound = static_cast<Bound>(bound);
+	entry.move = Move::FromString(fields[1]);
+	return entry;
+}
+
+} // namespace Carp
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "def.h"
+#include "move.h"
+#include "tt.h"
+
+namespace Carp
+{
+
+class Position;
+
+// hashexport默认沿着置换表走法导出的层数
+constexpr int DEFAULT_EXCHANGE_PLIES = 8;
+
+// 分布式搜索时进程之间交换的置换表项，带着完整的键，分数是相对这个节点的（和置换表里存的一样）
+struct TTExchangeEntry
+{
+	std::uint64_t key;
+	Move move;
+	Value value;
+	Bound bound;
+	int depth;
+};
+
+// 收集pos下面值得共享的项：根节点和它的每个子节点，再沿着置换表里的走法往下，一共最多max_plies层
+// 搜索的同时也可以调用，读到的项可能不完整，只是用来参考
+std::vector<TTExchangeEntry> CollectTTEntries(Position pos, const TranspositionTable& tt, int max_plies);
+// 本地没有这一项，或者本地的比它浅才写入
+void StoreTTEntry(TranspositionTable& tt, const TTExchangeEntry& entry) noexcept;
+
+// 文本格式："<键（16进制）> <走法> <分数> <边界> <深度>"，没有走法时是0000
+std::string FormatTTEntry(const TTExchangeEntry& entry);
+std::optional<TTExchangeEntry> ParseTTEntry(std::span<const std::string_view> fields) noexcept;
+
+} // namespace Carp
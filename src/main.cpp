@@ -1,7 +1,41 @@
+#include <charconv>
+#include <iostream>
+#include <string_view>
 #include "controller.h"
+#include "core/bench.h"
+#include "core/def.h"
+#ifdef CARP_HAS_SERVER
+#include "server.h"
+#endif // CARP_HAS_SERVER
 
 int main(int argc, char** argv)
 {
+    // "Carp bench [depth]"跑完基准测试就退出，PGO收集数据时用
+    if (argc >= 2 && std::string_view{ argv[1] } == "bench")
+    {
+        int depth = Carp::DEFAULT_BENCH_DEPTH;
+        if (argc >= 3)
+            std::from_chars(argv[2], argv[2] + std::string_view{ argv[2] }.size(), depth);
+        if (depth < 1 || depth >= Carp::MAX_PLY)
+            depth = Carp::DEFAULT_BENCH_DEPTH;
+        std::cout << Carp::BenchReport(depth) << std::endl;
+        return 0;
+    }
+
+#ifdef CARP_HAS_SERVER
+    // "Carp server <socket> [hash MB] [cores]"在一个进程里同时服务多盘棋
+    if (argc >= 3 && std::string_view{ argv[1] } == "server")
+    {
+        Carp::ServerConfig config;
+        config.socket_path = argv[2];
+        if (argc >= 4)
+            std::from_chars(argv[3], argv[3] + std::string_view{ argv[3] }.size(), config.hash_mb);
+        if (argc >= 5)
+            std::from_chars(argv[4], argv[4] + std::string_view{ argv[4] }.size(), config.cores);
+        return Carp::RunServer(config);
+    }
+#endif // CARP_HAS_SERVER
+
     Carp::Controller controller;
     controller.Loop();
     return 0;
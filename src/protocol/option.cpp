@@ -1,6 +1,7 @@
 #include "option.h"
 #include <algorithm>
 #include <charconv>
+#include "utils/trace.h"
 
 namespace Carp
 {
@@ -41,6 +42,7 @@ bool CaseInsensitiveEqual::operator()(std::string_view left, std::string_view ri
 
 void Option::OnChanged() const noexcept
 {
+	CARP_TRACE_SCOPE("option", "setoption", 0, m_name);
 	if (m_on_change)
 		m_on_change(*this);
 }
@@ -42,6 +42,17 @@ private:
 	std::string C_Go(std::span<std::string_view> commands);
 	std::string C_Stop(std::span<std::string_view> commands);
 	std::string C_PonderHit(std::span<std::string_view> commands);
+	// 以下是协议之外的调试命令
+	std::string C_Stats(std::span<std::string_view> commands);
+	std::string C_Perft(std::span<std::string_view> commands);
+	std::string C_Bench(std::span<std::string_view> commands);
+	std::string C_SaveHash(std::span<std::string_view> commands);
+	std::string C_LoadHash(std::span<std::string_view> commands);
+	// 分布式搜索的工作进程之间交换置换表项
+	std::string C_HashExport(std::span<std::string_view> commands);
+	std::string C_HashImport(std::span<std::string_view> commands);
+	// 分析整盘棋
+	std::string C_AnalyzeGame(std::span<std::string_view> commands);
 };
 
 } // namespace Carp
@@ -1,12 +1,60 @@
 #include "uci_command.h"
 #include <functional>
 #include <algorithm>
+#include <charconv>
 #include <numeric>
+#include <optional>
+#include <sstream>
 #include "option.h"
 #include "core/engine.h"
+#include "core/perft.h"
+#include "core/bench.h"
+#include "core/mate_search.h"
+#include "core/search.h"
+#include "core/tactics.h"
+#include "core/tt_exchange.h"
+#include "utils/cpu.h"
 
 namespace Carp
 {
+class OutputSearchUci : public OutputSearch
+{
+public:
+	virtual ~OutputSearchUci() {}
+
+	std::string Info(const SearchInfo& info) const override
+	{
+		std::ostringstream os;
+		os << "info depth " << info.depth << " seldepth " << info.sel_depth << " score ";
+		if (std::abs(info.score) >= VALUE_MATE_IN_MAX_PLY)
+			os << "mate " << (info.score > 0 ? (VALUE_MATE - info.score + 1) / 2 : -(VALUE_MATE + info.score) / 2);
+		else
+			os << "cp " << info.score;
+		os << " nodes " << info.nodes << " nps " << (info.time > 0 ? info.nodes * 1000 / info.time : info.nodes)
+			<< " time " << info.time << " pv";
+		for (auto move : info.pv)
+			os << ' ' << move.ToString();
+		return os.str();
+	}
+
+	std::string CurrMove(Move move, int number) const override
+	{
+		return "info currmove " + move.ToString() + " currmovenumber " + std::to_string(number);
+	}
+
+	std::string BestMove(Move best, Move ponder, [[maybe_unused]] bool draw) const override
+	{
+		if (!best)
+			return "bestmove (none)";
+		std::string res = "bestmove " + best.ToString();
+		if (ponder)
+			res += " ponder " + ponder.ToString();
+		return res;
+	}
+};
+
+static const OutputSearchUci OUTPUT_SEARCH_UCI;
+
 UciCommand::UciCommand(Engine& engine, OptionContainer& option_cont) :
 	m_engine(engine),
 	m_option_container(option_cont),
@@ -17,6 +65,14 @@ UciCommand::UciCommand(Engine& engine, OptionContainer& option_cont) :
 		std::make_pair("go", &UciCommand::C_Go),
 		std::make_pair("stop", &UciCommand::C_Stop),
 		std::make_pair("ponderhit", &UciCommand::C_PonderHit),
+		std::make_pair("stats", &UciCommand::C_Stats),
+		std::make_pair("perft", &UciCommand::C_Perft),
+		std::make_pair("bench", &UciCommand::C_Bench),
+		std::make_pair("savehash", &UciCommand::C_SaveHash),
+		std::make_pair("loadhash", &UciCommand::C_LoadHash),
+		std::make_pair("hashexport", &UciCommand::C_HashExport),
+		std::make_pair("hashimport", &UciCommand::C_HashImport),
+		std::make_pair("analyzegame", &UciCommand::C_AnalyzeGame),
 	} {}
 
 UciCommand::~UciCommand() = default;
@@ -75,21 +131,117 @@ std::string UciCommand::C_SetOption(std::span<std::string_view> commands)
 
 std::string UciCommand::C_IsReady([[maybe_unused]] std::span<std::string_view> commands)
 {
+	m_engine.WaitForPendingWork();
 	return "readyok";
 }
 
 std::string UciCommand::C_Position(std::span<std::string_view> commands)
 {
+	constexpr std::string_view STARTPOS_STR = "startpos";
+	constexpr std::string_view FEN_STR = "fen";
+	constexpr std::string_view MOVES_STR = "moves";
+	constexpr std::string_view USAGE = "Use 'position {fen <fenstring> | startpos} [moves <move1> ... <moveN>]' to set position.";
+	if (commands.size() < 2)
+		return std::string{ USAGE };
+
+	// moves之后的都是走法
+	auto moves_iter = std::ranges::find(commands, MOVES_STR);
+	const auto moves_pos = static_cast<std::size_t>(std::distance(commands.begin(), moves_iter));
+	std::span<std::string_view> moves{};
+	if (moves_iter != commands.end())
+		moves = commands.subspan(moves_pos + 1);
+
+	std::string fen;
+	if (commands[1] == STARTPOS_STR)
+		fen = START_FEN;
+	else if (commands[1] == FEN_STR)
+	{
+		// fen里面有空格，被拆成了好几段，需要重新拼起来
+		for (std::size_t i = 2; i < moves_pos; i++)
+		{
+			if (!fen.empty())
+				fen += ' ';
+			fen += commands[i];
+		}
+	}
+	else
+		return std::string{ USAGE };
+
+	if (!m_engine.SetPosition(fen, moves))
+		return "Invalid position.";
 	return "";
 }
 
+// 解析go命令后面的数字，失败返回std::nullopt
+static std::optional<std::int64_t> ParseNumber(std::string_view str) noexcept
+{
+	std::int64_t value;
+	auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	if (ec != std::errc{} || ptr != str.data() + str.size())
+		return std::nullopt;
+	return value;
+}
+
 std::string UciCommand::C_Go(std::span<std::string_view> commands)
 {
+	SearchLimits limits;
+	std::string tactics_file;
+	const bool is_red = m_engine.GetPosition().SideToMove() == PlayerType::Red;
+	for (std::size_t i = 1; i < commands.size(); i++)
+	{
+		const auto key = commands[i];
+		if (key == "infinite")
+		{
+			limits.infinite = true;
+			continue;
+		}
+		if (key == "searchmoves")
+		{
+			// 后面能解析成走法的都算，直到下一个关键字
+			for (; i + 1 < commands.size() && Move::FromString(commands[i + 1]); i++)
+				limits.search_moves.push_back(Move::FromString(commands[i + 1]));
+			continue;
+		}
+		// go tactics <文件>：逐题搜索EPD文件里的战术题，报告解出的时间
+		if (key == "tactics" && i + 1 < commands.size())
+		{
+			tactics_file = commands[++i];
+			continue;
+		}
+		if (i + 1 >= commands.size())
+			break;
+		const auto value = ParseNumber(commands[i + 1]);
+		if (!value.has_value())
+			continue;
+		i++;
+		if (key == "mate")
+			limits.mate = static_cast<int>(std::clamp<std::int64_t>(*value, 1, MAX_MATE_MOVES));
+		else if (key == "depth")
+			limits.depth = static_cast<int>(std::clamp<std::int64_t>(*value, 1, MAX_PLY - 1));
+		else if (key == "nodes")
+			limits.nodes = static_cast<std::uint64_t>(std::max<std::int64_t>(*value, 1));
+		else if (key == "movetime")
+			limits.move_time = *value;
+		else if (key == (is_red ? "wtime" : "btime"))
+			limits.time = *value;
+		else if (key == (is_red ? "winc" : "binc"))
+			limits.increment = *value;
+		else if (key == "movestogo")
+			limits.moves_to_go = static_cast<int>(*value);
+	}
+	if (!tactics_file.empty())
+	{
+		if (limits.depth == MAX_PLY && !limits.nodes && !limits.move_time && !limits.time)
+			limits.move_time = DEFAULT_TACTICS_MOVE_TIME;
+		return m_engine.RunTactics(tactics_file, limits, OUTPUT_SEARCH_UCI);
+	}
+	m_engine.Go(limits, OUTPUT_SEARCH_UCI);
 	return "";
 }
 
-std::string UciCommand::C_Stop(std::span<std::string_view> commands)
+std::string UciCommand::C_Stop([[maybe_unused]] std::span<std::string_view> commands)
 {
+	m_engine.Stop();
 	return "";
 }
 
@@ -98,6 +250,94 @@ std::string UciCommand::C_PonderHit(std::span<std::string_view> commands)
 	return "";
 }
 
+std::string UciCommand::C_Stats(std::span<std::string_view> commands)
+{
+	constexpr std::string_view RESET_STR = "reset";
+	if (commands.size() >= 2 && commands[1] == RESET_STR)
+	{
+		m_engine.ResetStats();
+		return "";
+	}
+	return m_engine.GetStatsReport();
+}
+
+std::string UciCommand::C_Perft(std::span<std::string_view> commands)
+{
+	int depth = 0;
+	if (commands.size() >= 2)
+		std::from_chars(commands[1].data(), commands[1].data() + commands[1].size(), depth);
+	if (depth < 1)
+		return "Use 'perft <depth>' to count leaf nodes of the current position.";
+	return PerftReport(m_engine.GetPosition(), depth);
+}
+
+std::string UciCommand::C_Bench(std::span<std::string_view> commands)
+{
+	constexpr std::string_view USAGE = "Use 'bench [depth]' to search the built-in positions, "
+		"or 'bench attacks [depth]' to compare incremental attack maps with recomputation.";
+	// bench attacks [depth]：增量攻击表和重新计算的对比
+	const bool attacks = commands.size() >= 2 && commands[1] == "attacks";
+	const std::size_t depth_index = attacks ? 2 : 1;
+	int depth = attacks ? DEFAULT_ATTACK_BENCH_DEPTH : DEFAULT_BENCH_DEPTH;
+	if (commands.size() > depth_index)
+		std::from_chars(commands[depth_index].data(), commands[depth_index].data() + commands[depth_index].size(), depth);
+	if (depth < 1 || depth >= MAX_PLY || (attacks && depth > 5))
+		return std::string{ USAGE };
+	m_engine.Stop();
+	return attacks ? AttackMapBenchReport(depth) : BenchReport(depth);
+}
+
+std::string UciCommand::C_SaveHash(std::span<std::string_view> commands)
+{
+	if (commands.size() < 2)
+		return "Use 'savehash <file>' to write the hash table to disk.";
+	return m_engine.SaveHash(std::string{ commands[1] });
+}
+
+std::string UciCommand::C_LoadHash(std::span<std::string_view> commands)
+{
+	if (commands.size() < 2)
+		return "Use 'loadhash <file>' to read a hash table saved with the same Hash size.";
+	return m_engine.LoadHash(std::string{ commands[1] });
+}
+
+std::string UciCommand::C_HashExport(std::span<std::string_view> commands)
+{
+	int plies = DEFAULT_EXCHANGE_PLIES;
+	if (commands.size() >= 2)
+		std::from_chars(commands[1].data(), commands[1].data() + commands[1].size(), plies);
+	return m_engine.ExportHash(std::clamp(plies, 1, MAX_PLY));
+}
+
+std::string UciCommand::C_HashImport(std::span<std::string_view> commands)
+{
+	if (!m_engine.ImportHash(commands.subspan(1)))
+		return "Use 'hashimport <key> <move> <value> <bound> <depth>' to store a hash entry.";
+	return "";
+}
+
+std::string UciCommand::C_AnalyzeGame(std::span<std::string_view> commands)
+{
+	constexpr std::string_view USAGE = "Use 'analyzegame [depth <n>] [movetime <ms>] [blunder <cp>]' "
+		"to analyse every move given by the last position command.";
+	GameAnalysisConfig config;
+	for (std::size_t i = 1; i < commands.size(); i += 2)
+	{
+		const auto value = i + 1 < commands.size() ? ParseNumber(commands[i + 1]) : std::nullopt;
+		if (!value.has_value() || *value < 1)
+			return std::string{ USAGE };
+		if (commands[i] == "depth")
+			config.depth = static_cast<int>(std::min<std::int64_t>(*value, MAX_PLY - 1));
+		else if (commands[i] == "movetime")
+			config.move_time = *value;
+		else if (commands[i] == "blunder")
+			config.blunder_threshold = static_cast<Value>(std::min<std::int64_t>(*value, VALUE_MATE));
+		else
+			return std::string{ USAGE };
+	}
+	return m_engine.AnalyzeGame(config);
+}
+
 class OutputOptionUci : public OutputOption
 {
 public:
@@ -136,6 +376,8 @@ std::ostream& operator<<(std::ostream& os, const UciCommand& uci)
 {
 	os << "id name " << Engine::GetEngineName() << '\n';
 	os << "id author " << Engine::GetAuthorName() << '\n';
+	// 运行时选择的指令集版本
+	os << "info string cpu " << CpuPathName() << '\n';
 	uci.m_option_container.ForeachOption([&os](const Option& option)->void {
 		os << OutputOptionUci{ option } << '\n';
 	});
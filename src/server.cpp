@@ -0,0 +1,197 @@
+#include "server.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <streambuf>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "controller.h"
+#include "core/engine.h"
+#include "core/thread_budget.h"
+#include "core/tt.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+// 套接字的流缓冲，读有缓冲，写不缓冲
+// 写入的都是OSyncStream拼好的整块，同一时间只有一个线程在写
+class SocketBuf : public std::streambuf
+{
+public:
+	explicit SocketBuf(int fd) noexcept : m_fd(fd) { setg(m_in, m_in, m_in); }
+
+protected:
+	int_type underflow() override
+	{
+		ssize_t n;
+		do
+			n = recv(m_fd, m_in, sizeof(m_in), 0);
+		while (n < 0 && errno == EINTR);
+		if (n <= 0)
+			return traits_type::eof();
+		setg(m_in, m_in, m_in + n);
+		return traits_type::to_int_type(m_in[0]);
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize count) override
+	{
+		std::streamsize written = 0;
+		while (written < count)
+		{
+			// 对方断开时不要收到SIGPIPE
+			const auto n = send(m_fd, s + written, static_cast<std::size_t>(count - written), MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				break;
+			written += n;
+		}
+		return written;
+	}
+
+	int_type overflow(int_type ch) override
+	{
+		if (traits_type::eq_int_type(ch, traits_type::eof()))
+			return traits_type::not_eof(ch);
+		const char c = traits_type::to_char_type(ch);
+		return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+	}
+
+private:
+	const int m_fd;
+	char m_in[4096];
+};
+
+struct Session
+{
+	int fd = -1;
+	std::thread thread;
+	std::atomic<bool> finished{ false };
+};
+
+void RunSession(Session& session, const SharedResources& shared)
+{
+	SocketBuf buf{ session.fd };
+	std::istream is{ &buf };
+	std::ostream os{ &buf };
+	{
+		Controller controller{ os, shared };
+		controller.Loop(is);
+	}
+	session.finished = true;
+}
+
+void CloseSession(Session& session)
+{
+	session.thread.join();
+	close(session.fd);
+}
+
+int OpenListenSocket(const std::string& path)
+{
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(addr.sun_path))
+	{
+		std::cerr << "invalid socket path: " << path << std::endl;
+		return -1;
+	}
+	std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		std::cerr << "socket: " << std::strerror(errno) << std::endl;
+		return -1;
+	}
+	// 上次没有正常退出时会留下套接字文件
+	unlink(path.c_str());
+	if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+	{
+		std::cerr << "bind " << path << ": " << std::strerror(errno) << std::endl;
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+} // namespace
+
+int RunServer(const ServerConfig& config)
+{
+	SharedResources shared;
+	shared.tt = std::make_shared<TranspositionTable>();
+	if (!shared.tt->Resize(std::max<std::size_t>(config.hash_mb, 1)))
+	{
+		std::cerr << "failed to allocate " << config.hash_mb << " MB hash" << std::endl;
+		return 1;
+	}
+	const std::size_t cores = config.cores > 0 ? config.cores : std::max(std::thread::hardware_concurrency(), 1u);
+	ThreadBudget budget{ cores };
+	shared.thread_budget = &budget;
+
+	const int listen_fd = OpenListenSocket(config.socket_path);
+	if (listen_fd < 0)
+		return 1;
+	std::cout << Engine::GetEngineName() << " server on " << config.socket_path
+		<< ", hash " << config.hash_mb << " MB, " << cores << " cores" << std::endl;
+
+	std::list<std::unique_ptr<Session>> sessions;
+	pollfd fds[2] = { { listen_fd, POLLIN, 0 }, { STDIN_FILENO, POLLIN, 0 } };
+	std::string line;
+	bool quit = false;
+	while (!quit)
+	{
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		// 标准输入结束以后就不再看它，服务器一直运行到被杀掉
+		if (fds[1].revents & (POLLIN | POLLHUP))
+		{
+			if (std::getline(std::cin, line))
+				quit = line == "quit";
+			else
+				fds[1].fd = -1;
+		}
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0)
+			continue;
+		// 顺便回收已经断开的会话
+		std::erase_if(sessions, [](const auto& session) {
+			if (!session->finished)
+				return false;
+			CloseSession(*session);
+			return true;
+		});
+		auto& session = *sessions.emplace_back(std::make_unique<Session>());
+		session.fd = fd;
+		session.thread = std::thread(RunSession, std::ref(session), std::cref(shared));
+	}
+
+	// 关掉读的一端，会话的命令循环读到结尾就会停止搜索并退出
+	for (auto& session : sessions)
+		shutdown(session->fd, SHUT_RD);
+	for (auto& session : sessions)
+		CloseSession(*session);
+	close(listen_fd);
+	unlink(config.socket_path.c_str());
+	return 0;
+}
+
+} // namespace Carp
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Carp
+{
+
+struct ServerConfig
+{
+	std::string socket_path;
+	// 所有会话共用的置换表大小，单位MB
+	std::size_t hash_mb = 64;
+	// 所有会话加起来能用的核心数，0表示硬件线程数
+	std::size_t cores = 0;
+};
+
+// 服务器模式：在Unix域套接字上监听，每个连接是一个独立的会话，局面、选项和时间控制都是自己的
+// 会话之间共用置换表和核心预算，多下一盘棋只多一组搜索工作区，不用再起一个进程
+// 标准输入收到quit时关闭所有会话并返回，出错时返回非0
+int RunServer(const ServerConfig& config);
+
+} // namespace Carp
@@ -0,0 +1,137 @@
+#include "async_output.h"
+#include <algorithm>
+#include "osyncstream.h"
+#include "trace.h"
+
+namespace Carp
+{
+
+constexpr int DEFAULT_INTERVAL_MS = 100;
+
+bool InfoChannel::Post(InfoKind kind, std::string text)
+{
+	if (!m_queue.TryPush(InfoMessage{ kind, std::move(text) }))
+		return false;
+	m_output.NotifyPosted();
+	return true;
+}
+
+AsyncOutput::AsyncOutput(std::ostream& os) :
+	m_stream(os),
+	m_interval_ms(DEFAULT_INTERVAL_MS),
+	m_thread(&AsyncOutput::ThreadFunc, this) {}
+
+AsyncOutput::~AsyncOutput()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wake_mutex);
+		m_quit = true;
+	}
+	m_wake_cv.notify_one();
+	m_thread.join();
+
+	std::lock_guard<std::mutex> lock(m_write_mutex);
+	Collect();
+	Flush("");
+}
+
+InfoChannel* AsyncOutput::CreateChannel()
+{
+	std::lock_guard<std::mutex> lock(m_write_mutex);
+	return m_channels.emplace_back(std::make_unique<InfoChannel>(*this)).get();
+}
+
+void AsyncOutput::RemoveChannel(InfoChannel* channel)
+{
+	std::lock_guard<std::mutex> lock(m_write_mutex);
+	// 删之前把里面剩下的都取出来，免得丢了
+	Collect();
+	std::erase_if(m_channels, [channel](const auto& ptr) { return ptr.get() == channel; });
+}
+
+void AsyncOutput::SetInterval(int milliseconds) noexcept
+{
+	m_interval_ms.store(std::max(milliseconds, 1), std::memory_order_relaxed);
+	m_wake_cv.notify_one();
+}
+
+void AsyncOutput::WriteNow(std::string_view line)
+{
+	std::lock_guard<std::mutex> lock(m_write_mutex);
+	Collect();
+	Flush(line);
+}
+
+void AsyncOutput::ThreadFunc()
+{
+	CARP_TRACE_THREAD_NAME("output");
+	std::unique_lock<std::mutex> wake_lock(m_wake_mutex);
+	while (!m_quit)
+	{
+		m_wake_cv.wait(wake_lock, [this] { return m_quit || m_posted.load(); });
+		// 第一条info到了以后再等一个输出周期，把这段时间里的info合并起来
+		const auto interval = std::chrono::milliseconds(m_interval_ms.load(std::memory_order_relaxed));
+		m_wake_cv.wait_for(wake_lock, interval, [this] { return m_quit; });
+		if (m_quit)
+			break;
+
+		// 先清掉标记再收集，收集期间新来的info会再次唤醒
+		// 写的时候不拿着唤醒的锁，stdout阻塞时搜索线程Post不会被卡住
+		m_posted.exchange(false);
+		wake_lock.unlock();
+		{
+			std::lock_guard<std::mutex> lock(m_write_mutex);
+			Collect();
+			if (!m_pending.empty())
+				Flush("");
+		}
+		wake_lock.lock();
+	}
+}
+
+void AsyncOutput::NotifyPosted()
+{
+	// 一个周期里只有第一条info需要加锁唤醒输出线程
+	if (m_posted.exchange(true))
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_wake_mutex);
+	}
+	m_wake_cv.notify_one();
+}
+
+void AsyncOutput::Collect()
+{
+	InfoMessage message;
+	for (const auto& channel : m_channels)
+	{
+		while (channel->m_queue.TryPop(message))
+		{
+			// 除了info string以外，同种类的只留最新的
+			if (message.kind != InfoKind::String)
+			{
+				std::erase_if(m_pending, [kind = message.kind](const InfoMessage& msg) { return msg.kind == kind; });
+			}
+			m_pending.push_back(std::move(message));
+		}
+	}
+}
+
+void AsyncOutput::Flush(std::string_view extra_line)
+{
+	if (m_pending.empty() && extra_line.empty())
+		return;
+
+	// bestmove之类的立即输出会带在detail里
+	CARP_TRACE_SCOPE("output", "flush", static_cast<std::int64_t>(m_pending.size()), extra_line);
+	// 所有内容拼成一块，只加一次流的锁，只刷新一次
+	OSyncStream os{ m_stream };
+	for (const auto& message : m_pending)
+		os << message.text << '\n';
+	if (!extra_line.empty())
+		os << extra_line << '\n';
+	os << std::flush;
+	m_pending.clear();
+}
+
+} // namespace Carp
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "spsc_queue.h"
+
+namespace Carp
+{
+
+// info的种类，同一个种类在一个输出周期内只保留最新的一条
+enum class InfoKind : std::uint8_t
+{
+	String,   // info string之类的，不合并，全部按顺序输出
+	Pv,       // info depth ... pv ...
+	CurrMove, // info currmove ...
+};
+
+class AsyncOutput;
+
+struct InfoMessage
+{
+	InfoKind kind = InfoKind::String;
+	std::string text;
+};
+
+// 每个搜索线程一个，搜索线程往里面写，输出线程往外读
+class InfoChannel
+{
+public:
+	static constexpr std::size_t CAPACITY = 256;
+
+	explicit InfoChannel(AsyncOutput& output) noexcept : m_output(output) {}
+
+	// 队列满了就丢掉，info本来就会被合并，丢掉也没关系
+	bool Post(InfoKind kind, std::string text);
+
+private:
+	AsyncOutput& m_output;
+	SpscQueue<InfoMessage, CAPACITY> m_queue;
+
+	friend class AsyncOutput;
+};
+
+// 专门的输出线程，定期把所有InfoChannel里的info合并后一次性写出去，
+// 避免搜索线程频繁抢输出流的锁和刷新stdout；没有info的时候输出线程一直睡，不会定期醒来
+class AsyncOutput
+{
+public:
+	explicit AsyncOutput(std::ostream& os);
+	~AsyncOutput();
+	AsyncOutput(const AsyncOutput&) = delete;
+	AsyncOutput(AsyncOutput&&) = delete;
+	AsyncOutput& operator=(const AsyncOutput&) = delete;
+	AsyncOutput& operator=(AsyncOutput&&) = delete;
+
+	InfoChannel* CreateChannel();
+	void RemoveChannel(InfoChannel* channel);
+
+	// 设置info的输出间隔，单位毫秒
+	void SetInterval(int milliseconds) noexcept;
+
+	// 立即输出，之前积攒的info会先输出，用于bestmove和命令的回复
+	void WriteNow(std::string_view line);
+
+private:
+	std::ostream& m_stream;
+	std::atomic<int> m_interval_ms;
+	std::mutex m_write_mutex;
+	std::vector<std::unique_ptr<InfoChannel>> m_channels;
+	std::vector<InfoMessage> m_pending;
+
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake_cv;
+	// 上次收集以后有没有新的info，由第一个Post的线程设置并唤醒输出线程
+	std::atomic<bool> m_posted{ false };
+	bool m_quit = false;
+	std::thread m_thread;
+
+	void ThreadFunc();
+	void NotifyPosted();
+
+	friend class InfoChannel;
+	// 以下两个函数需要持有m_write_mutex
+	void Collect();
+	void Flush(std::string_view extra_line);
+};
+
+} // namespace Carp
@@ -0,0 +1,132 @@
+#include "block_file.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace Carp
+{
+
+namespace
+{
+// O_DIRECT时每次读写的大小
+constexpr std::size_t DIRECT_CHUNK = 4 * 1024 * 1024;
+}
+
+BlockFile::~BlockFile()
+{
+	Close();
+}
+
+bool BlockFile::OpenRead(const std::string& path, bool direct)
+{
+	Close();
+	if (direct && OpenDirect(path, false))
+		return true;
+	m_file = std::fopen(path.c_str(), "rb");
+	if (m_file != nullptr)
+		std::setvbuf(m_file, nullptr, _IONBF, 0);
+	return m_file != nullptr;
+}
+
+bool BlockFile::OpenWrite(const std::string& path, bool direct)
+{
+	Close();
+	if (direct && OpenDirect(path, true))
+		return true;
+	m_file = std::fopen(path.c_str(), "wb");
+	if (m_file != nullptr)
+		std::setvbuf(m_file, nullptr, _IONBF, 0);
+	return m_file != nullptr;
+}
+
+bool BlockFile::OpenDirect([[maybe_unused]] const std::string& path, [[maybe_unused]] bool write)
+{
+#if defined(__linux__) && defined(O_DIRECT)
+	const int flags = (write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY) | O_DIRECT | O_CLOEXEC;
+	const int fd = open(path.c_str(), flags, 0644);
+	if (fd < 0)
+		return false;
+	if (m_storage == nullptr)
+	{
+		m_storage.reset(new (std::nothrow) std::byte[DIRECT_CHUNK + ALIGNMENT]);
+		if (m_storage == nullptr)
+		{
+			close(fd);
+			return false;
+		}
+		const auto addr = reinterpret_cast<std::uintptr_t>(m_storage.get());
+		m_buffer = m_storage.get() + (ALIGNMENT - addr % ALIGNMENT) % ALIGNMENT;
+	}
+	m_fd = fd;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void BlockFile::Close() noexcept
+{
+	if (m_file != nullptr)
+	{
+		std::fclose(m_file);
+		m_file = nullptr;
+	}
+#if defined(__linux__)
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+#endif // __linux__
+}
+
+bool BlockFile::Read(void* data, std::size_t size)
+{
+	if (m_file != nullptr)
+		return std::fread(data, 1, size, m_file) == size;
+#if defined(__linux__)
+	auto* dest = static_cast<std::byte*>(data);
+	while (m_fd >= 0 && size > 0)
+	{
+		const auto chunk = std::min(size, DIRECT_CHUNK);
+		const auto n = read(m_fd, m_buffer, chunk);
+		if (n != static_cast<ssize_t>(chunk))
+			return false;
+		std::memcpy(dest, m_buffer, chunk);
+		dest += chunk;
+		size -= chunk;
+	}
+	return m_fd >= 0;
+#else
+	return false;
+#endif // __linux__
+}
+
+bool BlockFile::Write(const void* data, std::size_t size)
+{
+	if (m_file != nullptr)
+		return std::fwrite(data, 1, size, m_file) == size;
+#if defined(__linux__)
+	const auto* src = static_cast<const std::byte*>(data);
+	while (m_fd >= 0 && size > 0)
+	{
+		const auto chunk = std::min(size, DIRECT_CHUNK);
+		std::memcpy(m_buffer, src, chunk);
+		const auto n = write(m_fd, m_buffer, chunk);
+		if (n != static_cast<ssize_t>(chunk))
+			return false;
+		src += chunk;
+		size -= chunk;
+	}
+	return m_fd >= 0;
+#else
+	return false;
+#endif // __linux__
+}
+
+} // namespace Carp
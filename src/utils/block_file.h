@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace Carp
+{
+
+// 大块顺序读写的文件，用来把置换表之类的大块内存整个存盘
+// direct为true时在Linux上用O_DIRECT绕过页缓存，文件系统不支持就退回普通读写
+class BlockFile
+{
+public:
+	// O_DIRECT要求地址、长度和偏移都按这个对齐
+	static constexpr std::size_t ALIGNMENT = 4096;
+
+	BlockFile() = default;
+	~BlockFile();
+	BlockFile(const BlockFile&) = delete;
+	BlockFile& operator=(const BlockFile&) = delete;
+
+	bool OpenRead(const std::string& path, bool direct);
+	bool OpenWrite(const std::string& path, bool direct);
+	void Close() noexcept;
+	bool IsDirect() const noexcept { return m_fd >= 0; }
+
+	// 长度必须是ALIGNMENT的倍数，地址没有要求，O_DIRECT时经过内部对齐的缓冲区
+	bool Read(void* data, std::size_t size);
+	bool Write(const void* data, std::size_t size);
+
+private:
+	std::FILE* m_file = nullptr;
+	int m_fd = -1;
+	std::unique_ptr<std::byte[]> m_storage;
+	std::byte* m_buffer = nullptr;
+
+	bool OpenDirect(const std::string& path, bool write);
+};
+
+} // namespace Carp
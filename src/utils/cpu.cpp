@@ -0,0 +1,110 @@
+#include "cpu.h"
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CARP_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CARP_X86 1
+#endif
+
+namespace Carp
+{
+
+namespace
+{
+
+#ifdef CARP_X86
+struct CpuidResult
+{
+	std::uint32_t eax, ebx, ecx, edx;
+};
+
+CpuidResult Cpuid(std::uint32_t leaf, std::uint32_t subleaf) noexcept
+{
+	CpuidResult res{};
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+	res = { static_cast<std::uint32_t>(regs[0]), static_cast<std::uint32_t>(regs[1]),
+		static_cast<std::uint32_t>(regs[2]), static_cast<std::uint32_t>(regs[3]) };
+#else
+	__cpuid_count(leaf, subleaf, res.eax, res.ebx, res.ecx, res.edx);
+#endif
+	return res;
+}
+
+// 操作系统是否保存了对应的寄存器，没有的话即使CPU支持也不能用
+std::uint64_t XGetBv() noexcept
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	std::uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures DetectCpuFeatures() noexcept
+{
+	CpuFeatures features;
+#ifdef CARP_X86
+	const auto max_leaf = Cpuid(0, 0).eax;
+	if (max_leaf < 1)
+		return features;
+	const auto vendor = Cpuid(0, 0);
+	const auto leaf1 = Cpuid(1, 0);
+	features.popcnt = (leaf1.ecx >> 23) & 1;
+	features.sse41 = (leaf1.ecx >> 19) & 1;
+
+	const bool osxsave = (leaf1.ecx >> 27) & 1;
+	const std::uint64_t xcr0 = osxsave ? XGetBv() : 0;
+	const bool os_avx = (xcr0 & 0x06) == 0x06;
+	const bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+	if (max_leaf >= 7)
+	{
+		const auto leaf7 = Cpuid(7, 0);
+		features.avx2 = os_avx && ((leaf7.ebx >> 5) & 1);
+		features.bmi2 = (leaf7.ebx >> 8) & 1;
+		// 只用到F和BW
+		features.avx512 = os_avx512 && ((leaf7.ebx >> 16) & 1) && ((leaf7.ebx >> 30) & 1);
+	}
+
+	// "AuthenticAMD"，family 0x19（Zen 3）开始PEXT才是硬件实现
+	const bool amd = vendor.ebx == 0x68747541 && vendor.edx == 0x69746e65 && vendor.ecx == 0x444d4163;
+	const std::uint32_t family = ((leaf1.eax >> 8) & 0x0f) + ((leaf1.eax >> 20) & 0xff);
+	features.fast_pext = features.bmi2 && (!amd || family >= 0x19);
+#endif
+	return features;
+}
+
+} // namespace
+
+const CpuFeatures& GetCpuFeatures() noexcept
+{
+	static const CpuFeatures features = DetectCpuFeatures();
+	return features;
+}
+
+std::string_view CpuPathName() noexcept
+{
+	const bool pext = GetCpuFeatures().fast_pext;
+#if CARP_HAS_CPU_DISPATCH
+	// 和target_clones的解析函数用同一套判断，保证报告的就是实际运行的版本
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("x86-64-v4"))
+		return pext ? "x86-64-v4 (avx512, pext)" : "x86-64-v4 (avx512)";
+	if (__builtin_cpu_supports("x86-64-v3"))
+		return pext ? "x86-64-v3 (avx2, pext)" : "x86-64-v3 (avx2)";
+	if (__builtin_cpu_supports("x86-64-v2"))
+		return "x86-64-v2 (sse4.2, popcnt)";
+	return "x86-64 (scalar)";
+#else
+	return pext ? "native (pext)" : "native";
+#endif
+}
+
+} // namespace Carp
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string_view>
+
+namespace Carp
+{
+
+// 运行时用CPUID检测到的指令集
+struct CpuFeatures
+{
+	bool popcnt = false;
+	bool sse41 = false;
+	bool avx2 = false;
+	bool bmi2 = false;
+	bool avx512 = false;
+	// Zen 3之前的AMD处理器PEXT/PDEP是微码实现的，比查射线还慢
+	bool fast_pext = false;
+};
+
+const CpuFeatures& GetCpuFeatures() noexcept;
+// 热点函数实际使用的版本，和CARP_CPU_DISPATCH的选择规则一致
+std::string_view CpuPathName() noexcept;
+
+} // namespace Carp
+
+// 热点函数按x86-64的几个微架构等级各编译一份，程序加载时根据CPU选择（GCC的target_clones）
+// 这样同一个二进制在新的CPU上也能用上popcnt、tzcnt、BMI2等指令；用-march=native编译时不需要
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__ELF__) && !defined(CARP_NATIVE_BUILD)
+#define CARP_HAS_CPU_DISPATCH 1
+#define CARP_CPU_DISPATCH __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3", "arch=x86-64-v4")))
+#else
+#define CARP_HAS_CPU_DISPATCH 0
+#define CARP_CPU_DISPATCH
+#endif
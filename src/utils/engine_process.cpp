@@ -0,0 +1,235 @@
+#include "engine_process.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define CARP_HAS_PROCESS
+#endif
+
+namespace Carp
+{
+
+#ifdef CARP_HAS_PROCESS
+
+EngineProcess::~EngineProcess()
+{
+	Quit();
+}
+
+bool EngineProcess::Start(const std::string& path)
+{
+	char* const argv[] = { const_cast<char*>(path.c_str()), nullptr };
+	return Spawn(path.c_str(), argv);
+}
+
+bool EngineProcess::StartShell(const std::string& command)
+{
+	char* const argv[] = { const_cast<char*>("sh"), const_cast<char*>("-c"), const_cast<char*>(command.c_str()), nullptr };
+	return Spawn("/bin/sh", argv);
+}
+
+bool EngineProcess::Spawn(const char* path, char* const argv[])
+{
+	// 子进程退出以后再往管道里写会收到SIGPIPE，不能让整个进程因此退出
+	signal(SIGPIPE, SIG_IGN);
+	int to_engine[2];
+	int from_engine[2];
+	if (pipe(to_engine) != 0)
+		return false;
+	if (pipe(from_engine) != 0)
+	{
+		close(to_engine[0]);
+		close(to_engine[1]);
+		return false;
+	}
+
+	const pid_t pid = fork();
+	if (pid < 0)
+	{
+		for (int fd : { to_engine[0], to_engine[1], from_engine[0], from_engine[1] })
+			close(fd);
+		return false;
+	}
+	if (pid == 0)
+	{
+		dup2(to_engine[0], STDIN_FILENO);
+		dup2(from_engine[1], STDOUT_FILENO);
+		for (int fd : { to_engine[0], to_engine[1], from_engine[0], from_engine[1] })
+			close(fd);
+		execv(path, argv);
+		_exit(127);
+	}
+
+	close(to_engine[0]);
+	close(from_engine[1]);
+	// 其它线程同时启动子进程时不要把这两个管道继承过去
+	fcntl(to_engine[1], F_SETFD, FD_CLOEXEC);
+	fcntl(from_engine[0], F_SETFD, FD_CLOEXEC);
+	m_pid = pid;
+	m_to_engine = to_engine[1];
+	m_from_engine = from_engine[0];
+	m_buffer.clear();
+	m_output_closed = false;
+	return true;
+}
+
+void EngineProcess::Quit()
+{
+	if (m_pid <= 0)
+		return;
+	Send("quit");
+	close(m_to_engine);
+	close(m_from_engine);
+
+	// 最多等一秒
+	int status = 0;
+	for (int i = 0; i < 100; i++)
+	{
+		if (waitpid(m_pid, &status, WNOHANG) == m_pid)
+		{
+			m_pid = -1;
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	if (m_pid > 0)
+	{
+		kill(m_pid, SIGKILL);
+		waitpid(m_pid, &status, 0);
+	}
+	m_pid = -1;
+	m_to_engine = m_from_engine = -1;
+}
+
+bool EngineProcess::Send(std::string_view line)
+{
+	if (m_pid <= 0)
+		return false;
+	std::string data{ line };
+	data += '\n';
+	std::size_t written = 0;
+	while (written < data.size())
+	{
+		const auto n = write(m_to_engine, data.data() + written, data.size() - written);
+		if (n <= 0)
+			return false;
+		written += static_cast<std::size_t>(n);
+	}
+	return true;
+}
+
+std::optional<std::string> EngineProcess::ReadLine(std::int64_t timeout_ms)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (true)
+	{
+		if (auto line = TakeLine())
+			return line;
+		if (m_pid <= 0)
+			return std::nullopt;
+
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if (remaining <= 0)
+			return std::nullopt;
+		pollfd fd{ m_from_engine, POLLIN, 0 };
+		if (poll(&fd, 1, static_cast<int>(remaining)) <= 0)
+			continue;
+		if (!ReadAvailable())
+			return std::nullopt;
+	}
+}
+
+bool EngineProcess::ReadAvailable()
+{
+	if (m_pid <= 0 || m_output_closed)
+		return false;
+	char buffer[4096];
+	const auto n = read(m_from_engine, buffer, sizeof(buffer));
+	// 管道关闭说明进程已经退出了
+	if (n <= 0)
+	{
+		m_output_closed = true;
+		return false;
+	}
+	m_buffer.append(buffer, static_cast<std::size_t>(n));
+	return true;
+}
+
+std::optional<std::string> EngineProcess::TryReadLine()
+{
+	if (auto line = TakeLine())
+		return line;
+	if (m_pid <= 0 || m_output_closed)
+		return std::nullopt;
+	pollfd fd{ m_from_engine, POLLIN, 0 };
+	if (poll(&fd, 1, 0) <= 0 || !ReadAvailable())
+		return std::nullopt;
+	return TakeLine();
+}
+
+void EngineProcess::WaitForOutput(std::span<EngineProcess* const> processes, std::int64_t timeout_ms)
+{
+	std::vector<pollfd> fds;
+	for (const auto* process : processes)
+	{
+		// 已经有完整的行了就不用等
+		if (process->m_buffer.find('\n') != std::string::npos)
+			return;
+		if (process->m_pid > 0 && !process->m_output_closed)
+			fds.push_back(pollfd{ process->m_from_engine, POLLIN, 0 });
+	}
+	if (fds.empty())
+		return;
+	poll(fds.data(), fds.size(), static_cast<int>(timeout_ms));
+}
+
+std::optional<std::string> EngineProcess::TakeLine()
+{
+	const auto pos = m_buffer.find('\n');
+	if (pos == std::string::npos)
+		return std::nullopt;
+	std::string line = m_buffer.substr(0, pos);
+	m_buffer.erase(0, pos + 1);
+	if (!line.empty() && line.back() == '\r')
+		line.pop_back();
+	return line;
+}
+
+std::optional<std::string> EngineProcess::WaitFor(std::string_view prefix, std::int64_t timeout_ms)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (true)
+	{
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		auto line = ReadLine(std::max<std::int64_t>(remaining, 0));
+		if (!line.has_value())
+			return std::nullopt;
+		if (line->starts_with(prefix))
+			return line;
+	}
+}
+
+#else // !CARP_HAS_PROCESS
+
+EngineProcess::~EngineProcess() = default;
+bool EngineProcess::Start(const std::string&) { return false; }
+bool EngineProcess::StartShell(const std::string&) { return false; }
+bool EngineProcess::Spawn(const char*, char* const[]) { return false; }
+void EngineProcess::Quit() {}
+bool EngineProcess::Send(std::string_view) { return false; }
+std::optional<std::string> EngineProcess::ReadLine(std::int64_t) { return std::nullopt; }
+std::optional<std::string> EngineProcess::WaitFor(std::string_view, std::int64_t) { return std::nullopt; }
+bool EngineProcess::ReadAvailable() { return false; }
+std::optional<std::string> EngineProcess::TakeLine() { return std::nullopt; }
+std::optional<std::string> EngineProcess::TryReadLine() { return std::nullopt; }
+void EngineProcess::WaitForOutput(std::span<EngineProcess* const>, std::int64_t) {}
+
+#endif // CARP_HAS_PROCESS
+
+} // namespace Carp
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Carp
+{
+
+// 以子进程方式运行的引擎，通过标准输入输出的管道收发协议命令，只支持POSIX系统
+class EngineProcess
+{
+public:
+	EngineProcess() = default;
+	~EngineProcess();
+	EngineProcess(const EngineProcess&) = delete;
+	EngineProcess& operator=(const EngineProcess&) = delete;
+
+	bool Start(const std::string& path);
+	// 用/bin/sh -c运行命令，可以带参数，比如"ssh host Carp"
+	bool StartShell(const std::string& command);
+	// 发送quit，等一会儿还不退出就直接杀掉
+	void Quit();
+	bool IsRunning() const noexcept { return m_pid > 0; }
+
+	bool Send(std::string_view line);
+	// 读一行，超时或者进程已经退出时返回nullopt
+	std::optional<std::string> ReadLine(std::int64_t timeout_ms);
+	// 一直读到以prefix开头的行，返回这一行
+	std::optional<std::string> WaitFor(std::string_view prefix, std::int64_t timeout_ms);
+
+	// 不阻塞，有完整的行就返回，管道关闭以后OutputClosed返回true
+	std::optional<std::string> TryReadLine();
+	bool OutputClosed() const noexcept { return m_output_closed; }
+	// 等到其中任何一个进程有输出或者超时
+	static void WaitForOutput(std::span<EngineProcess* const> processes, std::int64_t timeout_ms);
+
+private:
+	int m_pid = -1;
+	int m_to_engine = -1;
+	int m_from_engine = -1;
+	std::string m_buffer;
+	bool m_output_closed = false;
+
+	bool Spawn(const char* path, char* const argv[]);
+	// 读一次管道，管道关闭时返回false
+	bool ReadAvailable();
+	std::optional<std::string> TakeLine();
+};
+
+} // namespace Carp
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace Carp
+{
+
+// 按64字节缓存行对齐，std::hardware_destructive_interference_size在各编译器上的支持情况不一致
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// 单生产者单消费者的无锁环形队列，容量必须是2的幂
+template <typename T, std::size_t N>
+	requires (N >= 2 && (N & (N - 1)) == 0)
+class SpscQueue
+{
+public:
+	SpscQueue() = default;
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// 只能由生产者调用，队列满了返回false
+	bool TryPush(T&& value) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head_cache == N)
+		{
+			m_head_cache = m_head.load(std::memory_order_acquire);
+			if (tail - m_head_cache == N)
+				return false;
+		}
+		m_buffer[tail & (N - 1)] = std::move(value);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 只能由消费者调用，队列空了返回false
+	bool TryPop(T& value) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		const auto head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail_cache)
+		{
+			m_tail_cache = m_tail.load(std::memory_order_acquire);
+			if (head == m_tail_cache)
+				return false;
+		}
+		value = std::move(m_buffer[head & (N - 1)]);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// 生产者和消费者各自用到的数据分开放在不同的缓存行，避免伪共享
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail{ 0 };
+	std::size_t m_head_cache = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head{ 0 };
+	std::size_t m_tail_cache = 0;
+	alignas(CACHE_LINE_SIZE) std::array<T, N> m_buffer{};
+};
+
+} // namespace Carp
@@ -0,0 +1,61 @@
+#include "task_runner.h"
+
+namespace Carp
+{
+
+TaskRunner::TaskRunner() :
+	m_thread(&TaskRunner::ThreadFunc, this) {}
+
+TaskRunner::~TaskRunner()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_quit = true;
+	}
+	m_cv.notify_all();
+	m_thread.join();
+}
+
+void TaskRunner::Post(std::function<void()> task)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_cv.notify_all();
+}
+
+void TaskRunner::Wait()
+{
+	std::unique_lock lock(m_mutex);
+	m_cv.wait(lock, [this] { return m_tasks.empty() && !m_busy; });
+}
+
+bool TaskRunner::Idle()
+{
+	std::lock_guard lock(m_mutex);
+	return m_tasks.empty() && !m_busy;
+}
+
+void TaskRunner::ThreadFunc()
+{
+	std::unique_lock lock(m_mutex);
+	while (true)
+	{
+		m_cv.wait(lock, [this] { return !m_tasks.empty() || m_quit; });
+		if (m_tasks.empty())
+			return;
+		auto task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		m_busy = true;
+		lock.unlock();
+
+		task();
+
+		lock.lock();
+		m_busy = false;
+		m_cv.notify_all();
+	}
+}
+
+} // namespace Carp
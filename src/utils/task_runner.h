@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Carp
+{
+
+// 一个后台线程按提交的顺序执行任务，把耗时的操作移出处理命令的线程
+class TaskRunner
+{
+public:
+	TaskRunner();
+	// 剩下的任务执行完才返回
+	~TaskRunner();
+	TaskRunner(const TaskRunner&) = delete;
+	TaskRunner& operator=(const TaskRunner&) = delete;
+
+	void Post(std::function<void()> task);
+	// 等待已经提交的任务全部执行完，不能在任务里调用
+	void Wait();
+	// 没有排队和正在执行的任务
+	bool Idle();
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<std::function<void()>> m_tasks;
+	bool m_busy = false;
+	bool m_quit = false;
+	// 放在最后，保证线程开始运行时其它成员都已经初始化了
+	std::thread m_thread;
+
+	void ThreadFunc();
+};
+
+} // namespace Carp
@@ -0,0 +1,200 @@
+#include "trace.h"
+
+#ifdef CARP_TRACE
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "spsc_queue.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+// 每个线程最多攒这么多事件，一次搜索一般远远用不完
+constexpr std::size_t TRACE_BUFFER_SIZE = 1 << 14;
+
+const auto TRACE_EPOCH = std::chrono::steady_clock::now();
+
+// 线程自己是唯一的生产者，DumpTrace在持有注册表的锁时是唯一的消费者
+struct ThreadTrace
+{
+	SpscQueue<TraceEvent, TRACE_BUFFER_SIZE> queue;
+	std::atomic<std::uint64_t> dropped{ 0 };
+	// 线程退出以后缓冲区留给新线程用，里面没取走的事件还在
+	std::atomic<bool> in_use{ true };
+	int tid = 0;
+	std::string name;
+};
+
+struct TraceRegistry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadTrace>> threads;
+};
+
+TraceRegistry& Registry()
+{
+	static TraceRegistry registry;
+	return registry;
+}
+
+ThreadTrace* AcquireThreadTrace()
+{
+	auto& registry = Registry();
+	std::lock_guard lock(registry.mutex);
+	for (const auto& trace : registry.threads)
+	{
+		bool expected = false;
+		if (trace->in_use.compare_exchange_strong(expected, true))
+			return trace.get();
+	}
+	auto& trace = registry.threads.emplace_back(std::make_unique<ThreadTrace>());
+	trace->tid = static_cast<int>(registry.threads.size());
+	return trace.get();
+}
+
+struct ThreadTraceHandle
+{
+	ThreadTrace* const trace = AcquireThreadTrace();
+	~ThreadTraceHandle() { trace->in_use.store(false); }
+};
+
+ThreadTrace& CurrentThreadTrace()
+{
+	thread_local ThreadTraceHandle handle;
+	return *handle.trace;
+}
+
+void CopyDetail(std::array<char, 32>& dst, std::string_view detail) noexcept
+{
+	const auto size = std::min(detail.size(), dst.size() - 1);
+	std::copy_n(detail.data(), size, dst.data());
+	dst[size] = '\0';
+}
+
+void WriteJsonString(std::ostream& os, std::string_view str)
+{
+	os << '"';
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+			os << '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			os << c;
+	}
+	os << '"';
+}
+
+// Chrome trace的时间单位是微秒
+void WriteMicros(std::ostream& os, std::int64_t ns)
+{
+	os << ns / 1000 << '.' << static_cast<char>('0' + ns / 100 % 10) << static_cast<char>('0' + ns / 10 % 10) << static_cast<char>('0' + ns % 10);
+}
+
+} // namespace
+
+std::int64_t TraceNow() noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - TRACE_EPOCH).count();
+}
+
+void TraceRecord(const TraceEvent& event) noexcept
+{
+	auto& trace = CurrentThreadTrace();
+	auto copy = event;
+	if (!trace.queue.TryPush(std::move(copy)))
+		trace.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TraceInstant(const char* category, const char* name, std::int64_t arg, std::string_view detail) noexcept
+{
+	TraceEvent event{ name, category, TraceNow(), -1, arg };
+	CopyDetail(event.detail, detail);
+	TraceRecord(event);
+}
+
+void SetTraceThreadName(std::string_view name)
+{
+	auto& trace = CurrentThreadTrace();
+	std::lock_guard lock(Registry().mutex);
+	trace.name = name;
+}
+
+bool DumpTrace(const std::string& path, std::string& error)
+{
+	std::ofstream os(path);
+	if (!os)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	auto& registry = Registry();
+	std::lock_guard lock(registry.mutex);
+	os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	auto separator = [&]() -> std::ostream& {
+		os << (first ? "\n" : ",\n");
+		first = false;
+		return os;
+	};
+	TraceEvent event;
+	for (const auto& trace : registry.threads)
+	{
+		if (!trace->name.empty())
+		{
+			separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << trace->tid << ",\"args\":{\"name\":";
+			WriteJsonString(os, trace->name);
+			os << "}}";
+		}
+		while (trace->queue.TryPop(event))
+		{
+			separator() << "{\"ph\":\"" << (event.duration_ns < 0 ? "i\",\"s\":\"t" : "X") << "\",\"name\":";
+			WriteJsonString(os, event.name);
+			os << ",\"cat\":";
+			WriteJsonString(os, event.category);
+			os << ",\"pid\":1,\"tid\":" << trace->tid << ",\"ts\":";
+			WriteMicros(os, event.begin_ns);
+			if (event.duration_ns >= 0)
+			{
+				os << ",\"dur\":";
+				WriteMicros(os, event.duration_ns);
+			}
+			os << ",\"args\":{\"value\":" << event.arg;
+			if (event.detail[0] != '\0')
+			{
+				os << ",\"detail\":";
+				WriteJsonString(os, event.detail.data());
+			}
+			os << "}}";
+		}
+		if (const auto dropped = trace->dropped.exchange(0); dropped > 0)
+		{
+			separator() << "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"dropped\",\"cat\":\"trace\",\"pid\":1,\"tid\":" << trace->tid << ",\"ts\":";
+			WriteMicros(os, TraceNow());
+			os << ",\"args\":{\"value\":" << dropped << "}}";
+		}
+	}
+	os << "\n]}\n";
+	if (!os)
+	{
+		error = "failed to write " + path;
+		return false;
+	}
+	return true;
+}
+
+ScopedTrace::ScopedTrace(const char* category, const char* name, std::int64_t arg, std::string_view detail) noexcept :
+	m_event{ name, category, TraceNow(), -1, arg }
+{
+	CopyDetail(m_event.detail, detail);
+}
+
+} // namespace Carp
+#endif // CARP_TRACE
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Carp
+{
+
+// 搜索时间线的跟踪，每个线程把时间段记到自己的无锁缓冲区里，需要时写成Chrome trace格式的JSON，
+// 用chrome://tracing或者Perfetto打开，可以看到辅助线程什么时候闲着、stop之后多久才输出bestmove
+// 只有定义了CARP_TRACE（CMake选项CARP_ENABLE_TRACE）才会记录，否则下面的宏全是空的
+#ifdef CARP_TRACE
+constexpr bool TRACE_ENABLED = true;
+
+struct TraceEvent
+{
+	// 名字和分类都必须是字符串常量，附加的文字复制到detail里
+	const char* name = nullptr;
+	const char* category = nullptr;
+	std::int64_t begin_ns = 0;
+	// 小于0表示瞬间事件
+	std::int64_t duration_ns = -1;
+	std::int64_t arg = 0;
+	std::array<char, 32> detail{};
+};
+
+// 进程启动以来的纳秒数
+std::int64_t TraceNow() noexcept;
+// 写进当前线程的缓冲区，缓冲区满了就丢掉并计数
+void TraceRecord(const TraceEvent& event) noexcept;
+void TraceInstant(const char* category, const char* name, std::int64_t arg = 0, std::string_view detail = {}) noexcept;
+// 在时间线上显示的线程名
+void SetTraceThreadName(std::string_view name);
+// 取出所有线程到目前为止记录的事件写到path，取出的事件不会再写第二次
+bool DumpTrace(const std::string& path, std::string& error);
+
+// 构造到析构之间的一段时间
+class ScopedTrace
+{
+public:
+	ScopedTrace(const char* category, const char* name, std::int64_t arg = 0, std::string_view detail = {}) noexcept;
+	~ScopedTrace() { m_event.duration_ns = TraceNow() - m_event.begin_ns; TraceRecord(m_event); }
+	ScopedTrace(const ScopedTrace&) = delete;
+	ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+	TraceEvent m_event;
+};
+
+#define CARP_TRACE_CONCAT_IMPL(a, b) a##b
+#define CARP_TRACE_CONCAT(a, b) CARP_TRACE_CONCAT_IMPL(a, b)
+#define CARP_TRACE_SCOPE(category, name, ...) ::Carp::ScopedTrace CARP_TRACE_CONCAT(_carp_trace_, __LINE__){ category, name __VA_OPT__(,) __VA_ARGS__ }
+#define CARP_TRACE_INSTANT(category, name, ...) ::Carp::TraceInstant(category, name __VA_OPT__(,) __VA_ARGS__)
+#define CARP_TRACE_THREAD_NAME(name) ::Carp::SetTraceThreadName(name)
+#else // !CARP_TRACE
+constexpr bool TRACE_ENABLED = false;
+
+#define CARP_TRACE_SCOPE(category, name, ...) ((void)0)
+#define CARP_TRACE_INSTANT(category, name, ...) ((void)0)
+#define CARP_TRACE_THREAD_NAME(name) ((void)0)
+#endif // CARP_TRACE
+
+} // namespace Carp
@@ -0,0 +1,376 @@
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "core/batch_eval.h"
+#include "core/evaluate.h"
+#include "core/mate_search.h"
+#include "core/perft.h"
+#include "core/position.h"
+#include "core/search.h"
+#include "core/see.h"
+#include "core/tt.h"
+#include "utils/async_output.h"
+
+namespace
+{
+
+using namespace Carp;
+
+int g_failures = 0;
+
+// 失败时输出位置和表达式，继续跑后面的检查
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) \
+		{ \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #expr "\n"; \
+			g_failures++; \
+		} \
+	} while (false)
+
+Position FromFen(std::string_view fen)
+{
+	Position pos;
+	const bool ok = pos.SetFen(fen);
+	CHECK(ok);
+	return pos;
+}
+
+void TestPerft()
+{
+	// 初始局面的标准结果
+	constexpr std::uint64_t EXPECTED[] = { 44, 1920, 79666, 3290240, 133312995 };
+	Position pos;
+	for (int depth = 1; depth <= 5; depth++)
+		CHECK(Perft(pos, depth) == EXPECTED[depth - 1]);
+	// 搜完以后局面要还原
+	CHECK(pos.GetFen() == START_FEN);
+}
+
+void TestSee()
+{
+	const auto pawn = PieceValue(PieceType::Pawn);
+	const auto rook = PieceValue(PieceType::Rook);
+	const auto take = Move::FromString("e0e5");
+
+	// 没有保护的卒，白吃
+	auto pos = FromFen("3k5/9/9/9/4p4/9/9/9/9/4RK3 w");
+	CHECK(SeeGe(pos, take, 0));
+	CHECK(SeeGe(pos, take, pawn));
+	CHECK(!SeeGe(pos, take, pawn + 1));
+
+	// 卒有卒保护，车换卒亏
+	pos = FromFen("3k5/9/9/4p4/4p4/9/9/9/9/4RK3 w");
+	CHECK(!SeeGe(pos, take, 0));
+	CHECK(SeeGe(pos, take, pawn - rook));
+
+	// 马保护的卒，蹩住马腿以后就没有保护了
+	pos = FromFen("3k5/9/3n5/9/4p4/9/9/9/9/4RK3 w");
+	CHECK(!SeeGe(pos, take, 0));
+	pos = FromFen("3k5/9/3n5/3P5/4p4/9/9/9/9/4RK3 w");
+	CHECK(SeeGe(pos, take, 0));
+
+	// 炮和卒之间没有炮架时吃不回来，有的话车换卒亏
+	pos = FromFen("3k5/4c4/9/9/4p4/9/9/9/9/4RK3 w");
+	CHECK(SeeGe(pos, take, 0));
+	pos = FromFen("3k5/4c4/4n4/9/4p4/9/9/9/9/4RK3 w");
+	CHECK(!SeeGe(pos, take, 0));
+}
+
+void TestMove()
+{
+	CHECK(!Move{});
+	CHECK(!Move::FromString(""));
+	CHECK(!Move::FromString("a0"));
+	CHECK(!Move::FromString("j0a1"));
+	CHECK(!Move::FromString("a0a:"));
+
+	for (int from = 0; from < BOARD_FILE_NB * BOARD_RANK_NB; from++)
+	{
+		for (int to = 0; to < BOARD_FILE_NB * BOARD_RANK_NB; to++)
+		{
+			if (from == to)
+				continue;
+			const Move move{ static_cast<Square>(from), static_cast<Square>(to) };
+			CHECK(move);
+			CHECK(move.From() == from && move.To() == to);
+			CHECK(Move::FromRaw(move.GetRaw()) == move);
+			CHECK(Move::FromString(move.ToString()) == move);
+		}
+	}
+	const auto move = Move::FromString("h2e2");
+	CHECK(move.From() == MakeSquare(7, 2) && move.To() == MakeSquare(4, 2));
+	CHECK(move.ToString() == "h2e2");
+}
+
+void TestTT()
+{
+	TranspositionTable tt;
+	CHECK(tt.Resize(1));
+	const Position pos;
+	const auto key = pos.Key();
+	const auto move = Move::FromString("h2e2");
+
+	bool found = true;
+	auto* entry = tt.Probe(key, found);
+	CHECK(!found);
+	entry->Save(key, 123, Bound::Lower, 7, move, -45, tt.Generation());
+
+	entry = tt.Probe(key, found);
+	CHECK(found);
+	CHECK(entry->GetMove() == move);
+	CHECK(entry->GetValue() == 123);
+	CHECK(entry->GetEval() == -45);
+	CHECK(entry->GetDepth() == 7);
+	CHECK(entry->GetBound() == Bound::Lower);
+
+	// 新的一次搜索还能找到以前的项
+	tt.NewSearch();
+	tt.Probe(key, found);
+	CHECK(found);
+	tt.Probe(pos.KeyAfter(move), found);
+	CHECK(!found);
+
+	// 同时进行的搜索属于同一代，全部结束以后下一次搜索才换代
+	const auto generation = tt.Generation();
+	tt.BeginSearch();
+	const auto first = tt.Generation();
+	tt.BeginSearch();
+	CHECK(first != generation);
+	CHECK(tt.Generation() == first);
+	tt.EndSearch();
+	tt.EndSearch();
+	tt.BeginSearch();
+	CHECK(tt.Generation() != first);
+	tt.EndSearch();
+
+	tt.Clear();
+	tt.Probe(key, found);
+	CHECK(!found);
+
+	// 存盘、清空、读回来，普通读写和O_DIRECT交叉着来
+	constexpr int ENTRY_COUNT = 1000;
+	const auto entry_key = [](int i) { return 0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(i + 1); };
+	const auto check_entries = [&]
+	{
+		int hits = 0;
+		for (int i = 0; i < ENTRY_COUNT; i++)
+		{
+			bool hit = false;
+			const auto* saved = tt.Probe(entry_key(i), hit);
+			if (hit && saved->GetValue() == i && saved->GetDepth() == i % 20 && saved->GetMove() == move)
+				hits++;
+		}
+		return hits;
+	};
+	tt.NewSearch();
+	for (int i = 0; i < ENTRY_COUNT; i++)
+		tt.Probe(entry_key(i), found)->Save(entry_key(i), i, Bound::Exact, i % 20, move, 0, tt.Generation());
+	const int stored = check_entries();
+	CHECK(stored > ENTRY_COUNT * 9 / 10);
+	const auto saved_generation = tt.Generation();
+
+	const auto path = (std::filesystem::temp_directory_path() / "carp-tests-tt.bin").string();
+	const std::pair<bool, bool> modes[] = { { false, false }, { true, false }, { false, true }, { true, true } };
+	for (const auto [save_direct, load_direct] : modes)
+	{
+		std::string error;
+		CHECK(tt.Save(path, save_direct, error));
+		tt.Clear();
+		CHECK(check_entries() == 0);
+		CHECK(tt.Load(path, load_direct, error));
+		CHECK(check_entries() == stored);
+		CHECK(tt.Generation() == saved_generation);
+	}
+
+	// 大小不一样的文件不能读，表保持原样
+	std::string error;
+	CHECK(tt.Resize(2));
+	CHECK(!tt.Load(path, true, error));
+	CHECK(error.find("1 MB") != std::string::npos);
+	CHECK(check_entries() == 0);
+	CHECK(!tt.Load(path + ".missing", false, error));
+	std::filesystem::remove(path);
+}
+
+void TestFen()
+{
+	const std::string_view fens[] = {
+		START_FEN,
+		"rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C2C4/9/RNBAKABNR b - - 0 1",
+		"3k5/9/3n5/3P5/4p4/9/9/9/9/4RK3 w - - 0 1",
+		"2bak4/4a4/4b4/9/9/2p6/9/4B4/4A4/2BAK1r2 w - - 0 1",
+	};
+	for (const auto fen : fens)
+	{
+		const auto pos = FromFen(fen);
+		CHECK(pos.GetFen() == fen);
+	}
+
+	// 走几步以后导出再读回来，局面和哈希值都不变
+	Position pos;
+	for (const auto iccs : { "h2e2", "h9g7", "h0g2", "i9h9" })
+		pos.MakeMove(Move::FromString(iccs));
+	const auto copy = FromFen(pos.GetFen());
+	CHECK(copy.GetFen() == pos.GetFen());
+	CHECK(copy.Key() == pos.Key());
+	CHECK(copy.PawnKey() == pos.PawnKey());
+
+	Position invalid;
+	CHECK(!invalid.SetFen(""));
+	CHECK(!invalid.SetFen("rnbakabnr/9/1c5c1 w"));
+	CHECK(!invalid.SetFen("9/9/9/9/9/9/9/9/9/4K4 w"));
+	// 子太多，走法数会超过MoveList的容量
+	CHECK(!invalid.SetFen("3k5/8C/7C1/6C2/4C4/3C5/2C6/1C7/C8/5K3 w - - 0 1"));
+	CHECK(!invalid.SetFen("3k5/8C/7C1/6C2/4C4/3C5/2C6/1C7/C8/R4K3 w - - 0 1"));
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/P8/P1P1P1P1P/9/9/4K4 w"));
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/9/9/9/9/RR1K1R3 w"));
+	// 帅、士、相不在自己的格子上，兵在出发的那一行后面
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/9/9/9/9/K8 w"));
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/9/9/9/9/3KA4 w"));
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/9/9/9/4B4/3K5 w"));
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/4B4/9/9/9/3K5 w"));
+	CHECK(!invalid.SetFen("3k5/9/9/9/9/9/9/9/4P4/3K5 w"));
+	CHECK(!invalid.SetFen("3kb4/9/9/9/9/9/9/9/9/3K5 w"));
+	CHECK(!invalid.SetFen("3k5/4p4/9/9/9/9/9/9/9/3K5 w"));
+	// 失败以后变成初始局面
+	CHECK(invalid.GetFen() == START_FEN);
+}
+
+void TestPack()
+{
+	const std::string_view fens[] = {
+		START_FEN,
+		"rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C2C4/9/RNBAKABNR b - - 0 1",
+		"2bak4/4a4/4b4/9/9/2p6/9/4B4/4A4/2BAK1r2 w - - 0 1",
+	};
+	const GameOutcome outcomes[] = { GameOutcome::BlackWin, GameOutcome::Draw, GameOutcome::RedWin, GameOutcome::Unknown };
+	for (const auto fen : fens)
+	{
+		const auto pos = FromFen(fen);
+		for (const auto outcome : outcomes)
+		{
+			const auto entry = PackEntry(pos, -321, outcome);
+			CHECK(UnpackFen(entry) == pos.GetFen());
+			CHECK((entry.flags & 1) == (pos.SideToMove() == PlayerType::Black ? 1 : 0));
+			CHECK(static_cast<GameOutcome>((entry.flags >> 1) & 3) == outcome);
+			CHECK(entry.score == -321);
+		}
+	}
+}
+
+// 只记下最后一次info的节点数和bestmove，不输出
+class RecordOutput : public OutputSearch
+{
+public:
+	std::string Info(const SearchInfo& info) const override
+	{
+		nodes = info.nodes;
+		return "";
+	}
+	std::string CurrMove([[maybe_unused]] Move move, [[maybe_unused]] int number) const override { return ""; }
+	std::string BestMove(Move best_move, [[maybe_unused]] Move ponder, [[maybe_unused]] bool draw) const override
+	{
+		best = best_move;
+		return "";
+	}
+
+	mutable Move best;
+	mutable std::uint64_t nodes = 0;
+};
+
+void TestSearch()
+{
+	std::ostringstream os;
+	AsyncOutput output{ os };
+	TranspositionTable tt;
+	CHECK(tt.Resize(1));
+	Search search{ output, tt };
+	search.SetDeterministic(true);
+
+	const auto pos = FromFen("rnbakabnr/9/1c5c1/p1p1p1p1p/9/9/P1P1P1P1P/1C2C4/9/RNBAKABNR b - - 0 1");
+	SearchLimits limits;
+	limits.nodes = 20000;
+
+	// 同步搜索不清空置换表，两次之间自己清
+	search.SetThreads(1);
+	const auto first = search.SearchNow(pos, limits);
+	tt.Clear();
+	search.Clear();
+	const auto second = search.SearchNow(pos, limits);
+	CHECK(first.best);
+	CHECK(first.best == second.best);
+	CHECK(first.nodes == second.nodes);
+	CHECK(first.score == second.score);
+
+	// 两个线程轮流搜索，结果也是固定的
+	search.SetThreads(2);
+	RecordOutput runs[2];
+	for (auto& run : runs)
+	{
+		search.Start(pos, limits, run);
+		search.Wait();
+	}
+	CHECK(runs[0].best);
+	CHECK(runs[0].best == runs[1].best);
+	CHECK(runs[0].nodes > 0);
+	CHECK(runs[0].nodes == runs[1].nodes);
+}
+
+void TestMate()
+{
+	const auto never_stop = [](std::uint64_t) { return false; };
+	// 出帅以后黑方困毙，一步杀；车的连将杀要三步
+	auto pos = FromFen("3ak4/4a4/9/9/9/9/9/9/9/3K1R2R w");
+	auto result = FindMate(pos, MateSearchLimits{ 4, 0, {} }, never_stop);
+	CHECK(result.moves == 1);
+	CHECK(!result.pv.empty() && result.pv.front() == Move::FromString("d0e0"));
+
+	// 车沉底将死
+	pos = FromFen("4k4/9/4P4/9/9/9/9/9/9/3K4R w");
+	result = FindMate(pos, MateSearchLimits{ 3, 0, {} }, never_stop);
+	CHECK(result.moves == 1);
+	CHECK(!result.pv.empty() && result.pv.front() == Move::FromString("i0i9"));
+}
+
+} // namespace
+
+// 不带参数时跑所有的测试，否则只跑给出名字的
+int main(int argc, char** argv)
+{
+	const std::vector<std::pair<std::string_view, std::function<void()>>> tests = {
+		{ "perft", TestPerft },
+		{ "see", TestSee },
+		{ "move", TestMove },
+		{ "tt", TestTT },
+		{ "fen", TestFen },
+		{ "mate", TestMate },
+		{ "pack", TestPack },
+		{ "search", TestSearch },
+	};
+	int run = 0;
+	for (const auto& [name, test] : tests)
+	{
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; i++)
+			selected |= name == argv[i];
+		if (!selected)
+			continue;
+		const int failures = g_failures;
+		test();
+		std::cout << name << (g_failures == failures ? " passed" : " FAILED") << std::endl;
+		run++;
+	}
+	if (run == 0)
+	{
+		std::cerr << "usage: carp-tests [perft|see|move|tt|fen|mate|pack|search]...\n";
+		return 1;
+	}
+	return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "core/game_analysis.h"
+#include "core/search.h"
+#include "core/tt.h"
+#include "utils/async_output.h"
+
+namespace
+{
+
+constexpr std::string_view USAGE =
+	"usage: carp-analyze-game [options]\n"
+	"  --input <file>     PGN with ICCS moves, or one \"startpos|fen <FEN> [moves ...]\" per line (default stdin)\n"
+	"  --depth <n>        search depth per position (default 10)\n"
+	"  --movetime <ms>    search time per position, overrides --depth\n"
+	"  --blunder <cp>     score loss that marks a move as a blunder (default 150)\n"
+	"  --threads <n>      games analysed in parallel (default 1)\n"
+	"  --hash <mb>        hash size per thread (default 64)\n";
+
+bool ParseValue(std::string_view str, std::size_t& value)
+{
+	auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	return ec == std::errc{} && ptr == str.data() + str.size() && value > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Carp::GameAnalysisConfig config;
+	std::size_t threads = 1;
+	std::size_t hash_mb = 64;
+	std::string input_path;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		const std::string_view value = i + 1 < argc ? argv[i + 1] : std::string_view{};
+		std::size_t number = 0;
+		bool ok = !value.empty();
+		if (arg == "--input")
+			input_path = value;
+		else if (arg == "--depth" && (ok = ok && ParseValue(value, number)))
+			config.depth = static_cast<int>(std::min<std::size_t>(number, Carp::MAX_PLY - 1));
+		else if (arg == "--movetime" && (ok = ok && ParseValue(value, number)))
+			config.move_time = static_cast<std::int64_t>(number);
+		else if (arg == "--blunder" && (ok = ok && ParseValue(value, number)))
+			config.blunder_threshold = static_cast<Carp::Value>(std::min<std::size_t>(number, Carp::VALUE_MATE));
+		else if (arg == "--threads" && (ok = ok && ParseValue(value, number)))
+			threads = number;
+		else if (arg == "--hash" && (ok = ok && ParseValue(value, number)))
+			hash_mb = number;
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			std::cerr << "invalid argument: " << arg << "\n" << USAGE;
+			return 1;
+		}
+		i++;
+	}
+
+	std::ifstream input_file;
+	if (!input_path.empty())
+	{
+		input_file.open(input_path);
+		if (!input_file)
+		{
+			std::cerr << "failed to open " << input_path << "\n";
+			return 1;
+		}
+	}
+	const auto games = Carp::ReadGames(input_path.empty() ? std::cin : input_file);
+
+	// 每个线程一个Search和置换表，一盘棋从头到尾在同一个线程上分析，结果按输入的顺序输出
+	std::vector<std::optional<std::string>> reports(games.size());
+	std::size_t next_report = 0;
+	std::mutex report_mutex;
+	std::atomic<std::size_t> next_game{ 0 };
+	Carp::AsyncOutput silent_output(std::cerr);
+	auto worker = [&]() {
+		Carp::TranspositionTable tt;
+		tt.Resize(hash_mb);
+		Carp::Search search(silent_output, tt);
+		for (std::size_t index; (index = next_game.fetch_add(1)) < games.size(); )
+		{
+			const auto& game = games[index];
+			std::string report = "game " + std::to_string(index + 1);
+			if (!game.name.empty())
+				report += " " + game.name;
+			report += '\n';
+			if (!game.error.empty())
+				report += "skipped: " + game.error;
+			else if (const auto analysis = Carp::AnalyzeGame(search, game, config))
+				report += Carp::FormatGameAnalysis(*analysis, "");
+			else
+				report += "skipped: invalid position or illegal move";
+
+			std::lock_guard lock(report_mutex);
+			reports[index] = std::move(report);
+			for (; next_report < reports.size() && reports[next_report].has_value(); next_report++)
+			{
+				std::cout << *reports[next_report] << std::endl;
+				reports[next_report].reset();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (std::size_t i = 0; i < std::min(threads, std::max<std::size_t>(games.size(), 1)); i++)
+		workers.emplace_back(worker);
+	for (auto& thread : workers)
+		thread.join();
+	return 0;
+}
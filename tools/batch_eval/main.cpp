@@ -0,0 +1,91 @@
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "core/batch_eval.h"
+
+namespace
+{
+
+constexpr std::string_view USAGE =
+	"usage: carp-batch-eval --output <file> [options]\n"
+	"  --input <file>     one FEN per line, optionally followed by \" ; 1-0\", \" ; 0-1\" or \" ; 1/2-1/2\" (default stdin)\n"
+	"  --output <file>    binary output, 48 bytes per position\n"
+	"  --depth <n>        search depth per position (default 6)\n"
+	"  --threads <n>      search threads (default: hardware threads)\n"
+	"  --hash <mb>        hash size per thread (default 16)\n";
+
+bool ParseValue(std::string_view str, std::size_t& value)
+{
+	auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	return ec == std::errc{} && ptr == str.data() + str.size() && value > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Carp::BatchEvalConfig config;
+	config.threads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::string input_path;
+	std::string output_path;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		const std::string_view value = i + 1 < argc ? argv[i + 1] : std::string_view{};
+		std::size_t number = 0;
+		bool ok = !value.empty();
+		if (arg == "--input")
+			input_path = value;
+		else if (arg == "--output")
+			output_path = value;
+		else if (arg == "--depth" && (ok = ok && ParseValue(value, number)))
+			config.depth = static_cast<int>(std::min<std::size_t>(number, Carp::MAX_PLY - 1));
+		else if (arg == "--threads" && (ok = ok && ParseValue(value, number)))
+			config.threads = number;
+		else if (arg == "--hash" && (ok = ok && ParseValue(value, number)))
+			config.hash_mb = number;
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			std::cerr << "invalid argument: " << arg << "\n" << USAGE;
+			return 1;
+		}
+		i++;
+	}
+	if (output_path.empty())
+	{
+		std::cerr << USAGE;
+		return 1;
+	}
+
+	std::ifstream input_file;
+	if (!input_path.empty())
+	{
+		input_file.open(input_path);
+		if (!input_file)
+		{
+			std::cerr << "failed to open " << input_path << "\n";
+			return 1;
+		}
+	}
+	std::ofstream output(output_path, std::ios::binary);
+	if (!output)
+	{
+		std::cerr << "failed to open " << output_path << "\n";
+		return 1;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto stats = Carp::EvaluateBatch(input_path.empty() ? std::cin : input_file, output, config);
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cerr << "positions " << stats.positions << " skipped " << stats.skipped << " nodes " << stats.nodes
+		<< " time " << ms << " ms (" << (ms > 0 ? stats.positions * 1000 / ms : stats.positions) << " pos/s)\n";
+	return output ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include "core/bench.h"
+#include "core/def.h"
+
+int main(int argc, char** argv)
+{
+	int depth = Carp::DEFAULT_BENCH_DEPTH;
+	if (argc >= 2)
+	{
+		const std::string_view arg = argv[1];
+		std::from_chars(arg.data(), arg.data() + arg.size(), depth);
+	}
+	if (depth < 1 || depth >= Carp::MAX_PLY)
+	{
+		std::cerr << "usage: carp-bench [depth]\n";
+		return 1;
+	}
+	std::cout << Carp::BenchReport(depth) << std::endl;
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "elo.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Carp
+{
+
+namespace
+{
+
+double ScoreToElo(double score) noexcept
+{
+	score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+	return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double EloToScore(double elo) noexcept
+{
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// 每局得分的方差
+double ScoreVariance(const MatchScore& score, double mean) noexcept
+{
+	const auto games = static_cast<double>(score.Games());
+	return (score.wins * (1.0 - mean) * (1.0 - mean) + score.draws * (0.5 - mean) * (0.5 - mean)
+		+ score.losses * mean * mean) / games;
+}
+
+} // namespace
+
+double MatchScore::Ratio() const noexcept
+{
+	const auto games = Games();
+	return games == 0 ? 0.5 : (wins + draws * 0.5) / static_cast<double>(games);
+}
+
+EloEstimate EstimateElo(const MatchScore& score) noexcept
+{
+	if (score.Games() == 0)
+		return EloEstimate{ 0.0, 0.0 };
+	const double mean = score.Ratio();
+	const double deviation = std::sqrt(ScoreVariance(score, mean) / static_cast<double>(score.Games()));
+	const double low = ScoreToElo(mean - 1.959964 * deviation);
+	const double high = ScoreToElo(mean + 1.959964 * deviation);
+	return EloEstimate{ ScoreToElo(mean), (high - low) / 2.0 };
+}
+
+double SprtConfig::LowerBound() const noexcept
+{
+	return std::log(beta / (1.0 - alpha));
+}
+
+double SprtConfig::UpperBound() const noexcept
+{
+	return std::log((1.0 - beta) / alpha);
+}
+
+double SprtLlr(const MatchScore& score, const SprtConfig& config) noexcept
+{
+	if (score.wins == 0 || score.losses == 0)
+		return 0.0;
+	const double mean = score.Ratio();
+	const double variance = ScoreVariance(score, mean);
+	if (variance <= 0.0)
+		return 0.0;
+	const double s0 = EloToScore(config.elo0);
+	const double s1 = EloToScore(config.elo1);
+	return static_cast<double>(score.Games()) * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * variance);
+}
+
+} // namespace Carp
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Carp
+{
+
+// 都是从第一个引擎的角度统计的
+struct MatchScore
+{
+	std::uint64_t wins = 0;
+	std::uint64_t draws = 0;
+	std::uint64_t losses = 0;
+
+	std::uint64_t Games() const noexcept { return wins + draws + losses; }
+	// 得分率，和棋算半分
+	double Ratio() const noexcept;
+};
+
+struct EloEstimate
+{
+	double elo;
+	// 95%置信区间的半宽
+	double error;
+};
+
+EloEstimate EstimateElo(const MatchScore& score) noexcept;
+
+// 序贯概率比检验，H0：elo差为elo0，H1：elo差为elo1
+struct SprtConfig
+{
+	double elo0 = 0.0;
+	double elo1 = 5.0;
+	double alpha = 0.05;
+	double beta = 0.05;
+
+	double LowerBound() const noexcept;
+	double UpperBound() const noexcept;
+};
+
+// 对数似然比，用三项分布的正态近似
+double SprtLlr(const MatchScore& score, const SprtConfig& config) noexcept;
+
+} // namespace Carp
@@ -0,0 +1,139 @@
+#include <charconv>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "core/position.h"
+#include "match.h"
+
+namespace
+{
+
+constexpr std::string_view USAGE =
+	"usage: carp-match [options]\n"
+	"  --engine1 <path>          first engine, results are from its side (default bin/Carp)\n"
+	"  --engine2 <path>          second engine (default same as engine1)\n"
+	"  --option1 <name>=<value>  setoption for the first engine, can be repeated\n"
+	"  --option2 <name>=<value>  setoption for the second engine, can be repeated\n"
+	"  --games <n>               number of games (default 1000)\n"
+	"  --concurrency <n>         games played at the same time (default: hardware threads)\n"
+	"  --movetime <ms> | --nodes <n> | --depth <n>   limit per move (default movetime 100)\n"
+	"  --openings <file>         one FEN per line (default: built-in openings)\n"
+	"  --sprt <elo0> <elo1>      stop early once SPRT accepts H0 or H1\n"
+	"  --alpha <a> --beta <b>    SPRT error rates (default 0.05)\n"
+	"  --max-plies <n>           adjudicate a draw after n plies (default 400)\n";
+
+template <typename T>
+bool ParseValue(std::string_view str, T& value)
+{
+	auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	return ec == std::errc{} && ptr == str.data() + str.size();
+}
+
+bool ParseOption(std::string_view str, Carp::EngineConfig& engine)
+{
+	const auto pos = str.find('=');
+	if (pos == std::string_view::npos || pos == 0)
+		return false;
+	engine.options.emplace_back(std::string{ str.substr(0, pos) }, std::string{ str.substr(pos + 1) });
+	return true;
+}
+
+bool LoadOpenings(const std::string& path, std::vector<std::string>& openings)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+	Carp::Position pos;
+	for (std::string line; std::getline(file, line); )
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		// 不合法的局面直接跳过
+		if (!line.empty() && pos.SetFen(line))
+			openings.push_back(line);
+	}
+	return !openings.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	// 引擎进程退出后再写管道不要让自己也退出
+	std::signal(SIGPIPE, SIG_IGN);
+
+	Carp::MatchConfig config;
+	config.engines[0].path = "bin/Carp";
+	config.concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+	std::string engine2_path;
+	std::string openings_path;
+	Carp::SprtConfig sprt;
+	bool use_sprt = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		auto next = [&]() -> std::string_view { return i + 1 < argc ? argv[++i] : std::string_view{}; };
+		bool ok = true;
+		if (arg == "--engine1")
+			config.engines[0].path = next();
+		else if (arg == "--engine2")
+			engine2_path = next();
+		else if (arg == "--option1")
+			ok = ParseOption(next(), config.engines[0]);
+		else if (arg == "--option2")
+			ok = ParseOption(next(), config.engines[1]);
+		else if (arg == "--games")
+			ok = ParseValue(next(), config.games);
+		else if (arg == "--concurrency")
+			ok = ParseValue(next(), config.concurrency) && config.concurrency > 0;
+		else if (arg == "--movetime" || arg == "--nodes" || arg == "--depth")
+		{
+			std::uint64_t value = 0;
+			ok = ParseValue(next(), value);
+			config.go_command = "go " + std::string{ arg.substr(2) } + " " + std::to_string(value);
+		}
+		else if (arg == "--openings")
+			openings_path = next();
+		else if (arg == "--sprt")
+		{
+			use_sprt = true;
+			ok = ParseValue(next(), sprt.elo0) && ParseValue(next(), sprt.elo1);
+		}
+		else if (arg == "--alpha")
+			ok = ParseValue(next(), sprt.alpha);
+		else if (arg == "--beta")
+			ok = ParseValue(next(), sprt.beta);
+		else if (arg == "--max-plies")
+			ok = ParseValue(next(), config.max_plies);
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			std::cerr << "invalid argument: " << arg << "\n" << USAGE;
+			return 1;
+		}
+	}
+
+	config.engines[1].path = engine2_path.empty() ? config.engines[0].path : engine2_path;
+	if (use_sprt)
+		config.sprt = sprt;
+	if (openings_path.empty())
+		config.openings = Carp::DefaultOpenings();
+	else if (!LoadOpenings(openings_path, config.openings))
+	{
+		std::cerr << "failed to load openings from " << openings_path << "\n";
+		return 1;
+	}
+
+	std::cout << "engine1 " << config.engines[0].path << " vs engine2 " << config.engines[1].path
+		<< ", " << config.games << " games, concurrency " << config.concurrency
+		<< ", " << config.openings.size() << " openings, " << config.go_command << std::endl;
+	Carp::Match match(std::move(config));
+	match.Run();
+	return 0;
+}
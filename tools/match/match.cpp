@@ -0,0 +1,198 @@
+#include "match.h"
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include "core/movegen.h"
+#include "core/position.h"
+#include "utils/engine_process.h"
+
+namespace Carp
+{
+
+// 启动和isready的等待时间
+constexpr std::int64_t HANDSHAKE_TIMEOUT = 10000;
+// 没有吃子的步数超过这个判和，和引擎里的规则一致
+constexpr int RULE_MOVES_LIMIT = 120;
+// 每下这么多局输出一次进度
+constexpr std::uint64_t STATUS_INTERVAL = 20;
+
+Match::Match(MatchConfig config) :
+	m_config(std::move(config)) {}
+
+MatchScore Match::Run()
+{
+	std::vector<std::thread> threads;
+	threads.reserve(m_config.concurrency);
+	for (unsigned i = 0; i < m_config.concurrency; i++)
+		threads.emplace_back(&Match::Worker, this);
+	for (auto& thread : threads)
+		thread.join();
+
+	std::lock_guard lock(m_mutex);
+	// 最后一局刚好输出过的话就不重复了
+	if (m_finished || m_score.Games() % STATUS_INTERVAL != 0)
+		PrintStatus();
+	return m_score;
+}
+
+bool Match::InitEngine(EngineProcess& engine, const EngineConfig& config) const
+{
+	if (!engine.Start(config.path) || !engine.Send("uci") || !engine.WaitFor("uciok", HANDSHAKE_TIMEOUT))
+		return false;
+	bool has_threads = false;
+	for (const auto& [name, value] : config.options)
+	{
+		has_threads |= name == "Threads";
+		engine.Send("setoption name " + name + " value " + value);
+	}
+	// 并发下棋时每个引擎只用一个线程，免得互相抢CPU
+	if (!has_threads)
+		engine.Send("setoption name Threads value 1");
+	return engine.Send("isready") && engine.WaitFor("readyok", HANDSHAKE_TIMEOUT).has_value();
+}
+
+void Match::Worker()
+{
+	EngineProcess engines[2];
+	while (!m_finished)
+	{
+		const auto index = m_next_game++;
+		if (index >= m_config.games)
+			break;
+
+		// 崩溃或者超时的引擎在下一局开始前重新启动
+		for (int i = 0; i < 2; i++)
+		{
+			if (!engines[i].IsRunning() && !InitEngine(engines[i], m_config.engines[i]))
+			{
+				std::lock_guard lock(m_mutex);
+				std::cerr << "failed to start engine " << m_config.engines[i].path << std::endl;
+				m_finished = true;
+				return;
+			}
+		}
+		AddResult(PlayGame(index, engines));
+	}
+}
+
+Match::GameResult Match::PlayGame(std::uint64_t index, EngineProcess (&engines)[2]) const
+{
+	const auto& opening = m_config.openings[(index / 2) % m_config.openings.size()];
+	// 同一个开局连续两局交换先后手
+	const int red_engine = static_cast<int>(index % 2);
+
+	Position pos;
+	pos.SetFen(opening);
+	std::string position_command = "position fen " + opening + " moves";
+	for (auto& engine : engines)
+	{
+		engine.Send("setoption name Clear Hash");
+		engine.Send("isready");
+		engine.WaitFor("readyok", HANDSHAKE_TIMEOUT);
+	}
+
+	// 返回走子方所用引擎输掉的结果
+	auto lose = [&](int engine) {
+		return engine == 0 ? GameResult::SecondWin : GameResult::FirstWin;
+	};
+	for (int ply = 0; ply < m_config.max_plies; ply++)
+	{
+		const int side = pos.SideToMove() == PlayerType::Red ? red_engine : 1 - red_engine;
+		MoveList moves;
+		GenerateLegal<GenType::All>(pos, moves);
+		if (moves.empty())
+			return lose(side);
+		switch (pos.GetRepetition())
+		{
+		case RepetitionType::Draw: return GameResult::Draw;
+		case RepetitionType::Win: return lose(1 - side);
+		case RepetitionType::Loss: return lose(side);
+		case RepetitionType::None: break;
+		}
+		if (pos.RuleMoves() >= RULE_MOVES_LIMIT || !pos.CanMakeMove())
+			return GameResult::Draw;
+
+		auto& engine = engines[side];
+		engine.Send(position_command);
+		engine.Send(m_config.go_command);
+		const auto reply = engine.WaitFor("bestmove", m_config.move_timeout);
+		if (!reply.has_value())
+		{
+			engine.Quit();
+			return lose(side);
+		}
+		if (reply->size() < 13)
+			return lose(side);
+		const auto move_str = std::string_view{ *reply }.substr(9, 4);
+		const auto move = Move::FromString(move_str);
+		if (!moves.Contains(move))
+			return lose(side);
+		pos.MakeMove(move);
+		position_command += ' ';
+		position_command += move_str;
+	}
+	return GameResult::Draw;
+}
+
+void Match::AddResult(GameResult result)
+{
+	std::lock_guard lock(m_mutex);
+	switch (result)
+	{
+	case GameResult::FirstWin: m_score.wins++; break;
+	case GameResult::Draw: m_score.draws++; break;
+	case GameResult::SecondWin: m_score.losses++; break;
+	}
+
+	bool sprt_done = false;
+	if (m_config.sprt.has_value())
+	{
+		const double llr = SprtLlr(m_score, *m_config.sprt);
+		sprt_done = llr <= m_config.sprt->LowerBound() || llr >= m_config.sprt->UpperBound();
+	}
+	if (sprt_done)
+		m_finished = true;
+	if (m_score.Games() % STATUS_INTERVAL == 0 && !sprt_done)
+		PrintStatus();
+}
+
+void Match::PrintStatus() const
+{
+	const auto elo = EstimateElo(m_score);
+	std::cout << std::fixed << std::setprecision(2)
+		<< "games " << m_score.Games() << " +" << m_score.wins << " =" << m_score.draws << " -" << m_score.losses
+		<< " score " << m_score.Ratio() * 100.0 << "% elo " << elo.elo << " +/- " << elo.error;
+	if (m_config.sprt.has_value())
+	{
+		const auto& sprt = *m_config.sprt;
+		const double llr = SprtLlr(m_score, sprt);
+		std::cout << " llr " << llr << " (" << sprt.LowerBound() << ", " << sprt.UpperBound() << ")";
+		if (llr >= sprt.UpperBound())
+			std::cout << " H1 accepted";
+		else if (llr <= sprt.LowerBound())
+			std::cout << " H0 accepted";
+	}
+	std::cout << std::endl;
+}
+
+std::vector<std::string> DefaultOpenings()
+{
+	constexpr std::string_view RED_MOVES[] = { "h2e2", "b2e2", "c3c4", "g3g4", "b0c2", "h0g2", "c0e2", "g0e2", "h2d2", "b2f2" };
+	constexpr std::string_view BLACK_MOVES[] = { "h7e7", "b7e7", "c6c5", "g6g5", "b9c7", "h9g7" };
+	std::vector<std::string> openings;
+	Position pos;
+	for (auto red : RED_MOVES)
+	{
+		pos.MakeMove(Move::FromString(red));
+		for (auto black : BLACK_MOVES)
+		{
+			pos.MakeMove(Move::FromString(black));
+			openings.push_back(pos.GetFen());
+			pos.UnmakeMove();
+		}
+		pos.UnmakeMove();
+	}
+	return openings;
+}
+
+} // namespace Carp
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "elo.h"
+
+namespace Carp
+{
+
+class EngineProcess;
+
+struct EngineConfig
+{
+	std::string path;
+	// 开始前通过setoption设置，没有指定Threads的话默认用单线程
+	std::vector<std::pair<std::string, std::string>> options;
+};
+
+struct MatchConfig
+{
+	EngineConfig engines[2];
+	// 开局局面，每个开局两边各执红一次
+	std::vector<std::string> openings;
+	std::uint64_t games = 1000;
+	unsigned concurrency = 1;
+	// 每步发送的go命令，比如"go movetime 100"、"go nodes 20000"
+	std::string go_command = "go movetime 100";
+	// 超过这个步数判和
+	int max_plies = 400;
+	// 多久没有回复就判负
+	std::int64_t move_timeout = 10000;
+	std::optional<SprtConfig> sprt;
+};
+
+// 自对弈比赛，每个并发槽位有自己的两个引擎进程，从同一个计数器里领取对局，所有核都能一直占满
+class Match
+{
+public:
+	explicit Match(MatchConfig config);
+
+	// 下完所有对局或者SPRT有结论时返回
+	MatchScore Run();
+
+private:
+	enum class GameResult
+	{
+		FirstWin,
+		Draw,
+		SecondWin,
+	};
+
+	const MatchConfig m_config;
+	std::atomic<std::uint64_t> m_next_game{ 0 };
+	std::atomic<bool> m_finished{ false };
+	std::mutex m_mutex;
+	MatchScore m_score;
+
+	void Worker();
+	// 启动引擎并完成握手，失败返回false
+	bool InitEngine(EngineProcess& engine, const EngineConfig& config) const;
+	GameResult PlayGame(std::uint64_t index, EngineProcess (&engines)[2]) const;
+	void AddResult(GameResult result);
+	void PrintStatus() const;
+};
+
+// 内置的开局：从初始局面走两步常见的开局着法
+std::vector<std::string> DefaultOpenings();
+
+} // namespace Carp
@@ -0,0 +1,133 @@
+#include "harness.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+#include "core/engine.h"
+#include "utils/cpu.h"
+
+namespace Carp
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample
+{
+	double seconds;
+	std::uint64_t items;
+};
+
+Sample Measure(const MicroBenchFunc& run, std::uint64_t iterations)
+{
+	const auto start = Clock::now();
+	const auto items = run(iterations);
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	return Sample{ elapsed.count(), items };
+}
+
+// 次数从1开始往上加，直到一次能跑够min_time
+std::uint64_t CalibrateIterations(const MicroBenchFunc& run, double min_time)
+{
+	constexpr std::uint64_t MAX_ITERATIONS = 1'000'000'000;
+	std::uint64_t iterations = 1;
+	while (iterations < MAX_ITERATIONS)
+	{
+		const auto sample = Measure(run, iterations);
+		if (sample.seconds >= min_time)
+			break;
+		// 按已经用掉的时间估计需要的次数，多给一点余量，一次最多放大10倍
+		const double factor = sample.seconds > 0 ? min_time * 1.4 / sample.seconds : 10.0;
+		iterations = std::min(MAX_ITERATIONS, static_cast<std::uint64_t>(iterations * std::clamp(factor, 2.0, 10.0)));
+	}
+	return iterations;
+}
+
+void WriteJsonString(std::ostream& out, std::string_view str)
+{
+	out << '"';
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+			out << ' ';
+		else
+			out << c;
+	}
+	out << '"';
+}
+
+} // namespace
+
+std::vector<MicroBenchResult> RunMicroBenchmarks(const std::vector<MicroBenchmark>& benchmarks, const MicroBenchConfig& config, std::ostream& log)
+{
+	std::vector<MicroBenchResult> results;
+	for (const auto& bench : benchmarks)
+	{
+		if (!config.filter.empty() && bench.name.find(config.filter) == std::string::npos)
+			continue;
+
+		const auto iterations = CalibrateIterations(bench.run, config.min_time);
+		std::vector<double> ns;
+		std::uint64_t total_items = 0;
+		double total_seconds = 0;
+		for (int i = 0; i < std::max(config.repetitions, 1); i++)
+		{
+			const auto sample = Measure(bench.run, iterations);
+			ns.push_back(sample.seconds * 1e9 / static_cast<double>(iterations));
+			total_items += sample.items;
+			total_seconds += sample.seconds;
+		}
+		std::sort(ns.begin(), ns.end());
+
+		MicroBenchResult result{ bench.name, iterations, ns[ns.size() / 2], ns.front(),
+			total_seconds > 0 ? static_cast<double>(total_items) / total_seconds : 0.0 };
+		log << std::left << std::setw(40) << result.name << std::right
+			<< std::setw(14) << std::fixed << std::setprecision(1) << result.ns_per_iteration << " ns"
+			<< std::setw(16) << std::setprecision(0) << result.items_per_second << " items/s" << std::endl;
+		results.push_back(std::move(result));
+	}
+	return results;
+}
+
+void WriteMicroBenchJson(std::ostream& out, const std::vector<MicroBenchResult>& results, const MicroBenchConfig& config)
+{
+	char date[32] = {};
+	const auto now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	out << "{\n  \"context\": {\n";
+	out << "    \"date\": ";
+	WriteJsonString(out, date);
+	out << ",\n    \"engine\": ";
+	WriteJsonString(out, Engine::GetEngineName());
+	out << ",\n    \"cpu_path\": ";
+	WriteJsonString(out, CpuPathName());
+	out << ",\n    \"num_cpus\": " << std::thread::hardware_concurrency();
+	out << ",\n    \"min_time\": " << config.min_time;
+	out << ",\n    \"repetitions\": " << config.repetitions;
+	out << "\n  },\n  \"benchmarks\": [";
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		const auto& result = results[i];
+		out << (i == 0 ? "\n" : ",\n") << "    {\n      \"name\": ";
+		WriteJsonString(out, result.name);
+		out << ",\n      \"iterations\": " << result.iterations
+			<< std::fixed << std::setprecision(3)
+			<< ",\n      \"real_time\": " << result.ns_per_iteration
+			<< ",\n      \"min_real_time\": " << result.min_ns_per_iteration
+			<< ",\n      \"time_unit\": \"ns\""
+			<< std::setprecision(0)
+			<< ",\n      \"items_per_second\": " << result.items_per_second
+			<< std::defaultfloat
+			<< "\n    }";
+	}
+	out << "\n  ]\n}" << std::endl;
+}
+
+} // namespace Carp
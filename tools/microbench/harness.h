@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Carp
+{
+
+// 让编译器认为结果会被用到，防止被测的代码整个被优化掉
+template <typename T>
+inline void DoNotOptimize(const T& value) noexcept
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static const void* volatile sink;
+	sink = &value;
+#endif
+}
+
+// 执行iterations次，返回处理的项数（比如生成的走法数），用来算每秒多少项
+using MicroBenchFunc = std::function<std::uint64_t(std::uint64_t iterations)>;
+
+struct MicroBenchmark
+{
+	std::string name;
+	MicroBenchFunc run;
+};
+
+struct MicroBenchConfig
+{
+	// 每次重复至少跑这么多秒
+	double min_time = 0.2;
+	int repetitions = 3;
+	// 只跑名字里包含这个字符串的项目，空的话全部都跑
+	std::string filter;
+};
+
+struct MicroBenchResult
+{
+	std::string name;
+	std::uint64_t iterations;
+	// 各次重复的中位数和最小值
+	double ns_per_iteration;
+	double min_ns_per_iteration;
+	double items_per_second;
+};
+
+// 进度写到log里
+std::vector<MicroBenchResult> RunMicroBenchmarks(const std::vector<MicroBenchmark>& benchmarks, const MicroBenchConfig& config, std::ostream& log);
+
+// 格式和Google Benchmark的--benchmark_format=json类似，方便用现成的脚本比较
+void WriteMicroBenchJson(std::ostream& out, const std::vector<MicroBenchResult>& results, const MicroBenchConfig& config);
+
+} // namespace Carp
@@ -0,0 +1,275 @@
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "controller.h"
+#include "core/evaluate.h"
+#include "core/movegen.h"
+#include "core/position.h"
+#include "core/see.h"
+#include "core/tt.h"
+#include "harness.h"
+
+namespace
+{
+
+constexpr std::string_view USAGE =
+	"usage: carp-microbench [options]\n"
+	"  --filter <str>        only run benchmarks whose name contains str\n"
+	"  --min-time <sec>      minimum time per repetition (default 0.2)\n"
+	"  --repetitions <n>     repetitions per benchmark, the median is reported (default 3)\n"
+	"  --threads <n>         threads for the contended TT benchmark (default: hardware threads, at least 2)\n"
+	"  --out <file>          write JSON to file instead of stdout\n"
+	"  --list                print benchmark names and exit\n";
+
+// 几类有代表性的局面，走法生成的开销差别很大
+struct PositionClass
+{
+	std::string_view name;
+	std::string_view fen;
+};
+
+constexpr PositionClass POSITION_CLASSES[] = {
+	{ "opening", Carp::START_FEN },
+	{ "middlegame", "r1bakab1r/4n4/n5c2/p1C1p4/1C6p/2PN2p2/P5c2/4B3N/4A4/1RB1KAR2 w - - 2 1" },
+	{ "endgame", "3aka3/9/4b4/p8/8p/P1Bcr4/6r2/4B3R/2R1N4/3AKA3 w - - 0 1" },
+	// 红帅被e3的炮隔着e2的炮将军
+	{ "in_check", "r1bakab1r/9/2n1c1n2/p1p1p1p1p/9/9/P1P1c1P1P/1C2C1N2/9/RNBAKAB1R w - - 0 1" },
+};
+
+template <typename T>
+bool ParseValue(std::string_view str, T& value)
+{
+	auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	return ec == std::errc{} && ptr == str.data() + str.size();
+}
+
+Carp::Position MakePosition(std::string_view fen)
+{
+	Carp::Position pos;
+	pos.SetFen(fen);
+	return pos;
+}
+
+void AddMoveBenchmarks(std::vector<Carp::MicroBenchmark>& benchmarks)
+{
+	for (const auto& cls : POSITION_CLASSES)
+	{
+		const std::string suffix = "/" + std::string{ cls.name };
+		benchmarks.push_back({ "movegen_legal" + suffix, [pos = MakePosition(cls.fen)](std::uint64_t iterations) {
+			std::uint64_t moves = 0;
+			for (std::uint64_t i = 0; i < iterations; i++)
+			{
+				Carp::MoveList list;
+				Carp::GenerateLegal<Carp::GenType::All>(pos, list);
+				Carp::DoNotOptimize(list);
+				moves += list.size();
+			}
+			return moves;
+		} });
+		benchmarks.push_back({ "movegen_captures" + suffix, [pos = MakePosition(cls.fen)](std::uint64_t iterations) {
+			std::uint64_t moves = 0;
+			for (std::uint64_t i = 0; i < iterations; i++)
+			{
+				Carp::MoveList list;
+				Carp::GenerateLegal<Carp::GenType::Captures>(pos, list);
+				Carp::DoNotOptimize(list);
+				moves += list.size();
+			}
+			return moves;
+		} });
+	}
+
+	for (const auto& cls : POSITION_CLASSES)
+	{
+		// 每次迭代把所有合法走法都走一遍再退回来
+		benchmarks.push_back({ "make_unmake/" + std::string{ cls.name }, [pos = MakePosition(cls.fen)](std::uint64_t iterations) mutable {
+			Carp::MoveList list;
+			Carp::GenerateLegal<Carp::GenType::All>(pos, list);
+			for (std::uint64_t i = 0; i < iterations; i++)
+			{
+				for (const auto& [move, score] : list)
+				{
+					pos.MakeMove(move);
+					Carp::DoNotOptimize(pos);
+					pos.UnmakeMove();
+				}
+			}
+			return iterations * list.size();
+		} });
+	}
+
+	// 空着只更新键值和状态，用来看Zobrist更新本身的开销
+	benchmarks.push_back({ "zobrist_null_move", [pos = MakePosition(POSITION_CLASSES[1].fen)](std::uint64_t iterations) mutable {
+		for (std::uint64_t i = 0; i < iterations; i++)
+		{
+			pos.MakeNullMove();
+			Carp::DoNotOptimize(pos.Key());
+			pos.UnmakeNullMove();
+		}
+		return iterations;
+	} });
+}
+
+void AddEvalBenchmarks(std::vector<Carp::MicroBenchmark>& benchmarks)
+{
+	for (const auto& cls : POSITION_CLASSES)
+	{
+		benchmarks.push_back({ "eval_full/" + std::string{ cls.name }, [pos = MakePosition(cls.fen)](std::uint64_t iterations) {
+			for (std::uint64_t i = 0; i < iterations; i++)
+			{
+				Carp::DoNotOptimize(pos);
+				Carp::DoNotOptimize(Carp::Evaluate(pos));
+			}
+			return iterations;
+		} });
+	}
+
+	// 所有吃子走法的SEE，阈值0
+	benchmarks.push_back({ "see_captures/middlegame", [pos = MakePosition(POSITION_CLASSES[1].fen)](std::uint64_t iterations) {
+		Carp::MoveList list;
+		Carp::GenerateLegal<Carp::GenType::Captures>(pos, list);
+		for (std::uint64_t i = 0; i < iterations; i++)
+		{
+			for (const auto& [move, score] : list)
+				Carp::DoNotOptimize(Carp::SeeGe(pos, move, 0));
+		}
+		return iterations * list.size();
+	} });
+}
+
+void AddTTBenchmarks(std::vector<Carp::MicroBenchmark>& benchmarks, int threads)
+{
+	// 每个线程按自己的随机序列交替读写，所有线程共用一张表
+	auto run = [](Carp::TranspositionTable& tt, int thread_count, std::uint64_t iterations) {
+		auto worker = [&tt, iterations](std::uint64_t seed) {
+			std::mt19937_64 rng(seed);
+			for (std::uint64_t i = 0; i < iterations; i++)
+			{
+				const auto key = rng();
+				bool found = false;
+				auto* entry = tt.Probe(key, found);
+				if (!found || (key & 3) == 0)
+					entry->Save(key, static_cast<Carp::Value>(key & 0xff), Carp::Bound::Exact, static_cast<int>(key >> 60) + 1, Carp::Move{}, 0, tt.Generation());
+				Carp::DoNotOptimize(entry);
+			}
+		};
+		if (thread_count == 1)
+		{
+			worker(1);
+			return iterations;
+		}
+		std::vector<std::jthread> pool;
+		for (int t = 0; t < thread_count; t++)
+			pool.emplace_back(worker, static_cast<std::uint64_t>(t + 1));
+		return iterations * thread_count;
+	};
+
+	for (int thread_count : { 1, threads })
+	{
+		auto tt = std::make_shared<Carp::TranspositionTable>();
+		tt->Resize(64);
+		benchmarks.push_back({ "tt_probe_store/threads:" + std::to_string(thread_count), [tt, thread_count, run](std::uint64_t iterations) {
+			return run(*tt, thread_count, iterations);
+		} });
+		if (threads == 1)
+			break;
+	}
+}
+
+void AddControllerBenchmarks(std::vector<Carp::MicroBenchmark>& benchmarks)
+{
+	// 从开局随机走200步，生成一条很长的position命令，每次都要从头解析并走一遍
+	constexpr int PLIES = 200;
+	std::string line = "position startpos moves";
+	Carp::Position pos;
+	std::mt19937_64 rng(2024);
+	for (int ply = 0; ply < PLIES; ply++)
+	{
+		Carp::MoveList list;
+		Carp::GenerateLegal<Carp::GenType::All>(pos, list);
+		if (list.empty())
+			break;
+		const auto move = list[rng() % list.size()].move;
+		line += ' ';
+		line += move.ToString();
+		pos.MakeMove(move);
+	}
+
+	auto controller = std::make_shared<Carp::Controller>();
+	controller->HandleCommand("uci");
+	benchmarks.push_back({ "controller_position_line/plies:" + std::to_string(pos.GamePly()), [controller, line](std::uint64_t iterations) {
+		for (std::uint64_t i = 0; i < iterations; i++)
+			Carp::DoNotOptimize(controller->HandleCommand(line));
+		return iterations;
+	} });
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Carp::MicroBenchConfig config;
+	int threads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+	std::string out_path;
+	bool list_only = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		bool ok = true;
+		if (arg == "--filter" && has_value)
+			config.filter = argv[++i];
+		else if (arg == "--min-time" && has_value)
+			config.min_time = std::strtod(argv[++i], nullptr);
+		else if (arg == "--repetitions" && has_value)
+			ok = ParseValue(argv[++i], config.repetitions) && config.repetitions > 0;
+		else if (arg == "--threads" && has_value)
+			ok = ParseValue(argv[++i], threads) && threads > 0;
+		else if (arg == "--out" && has_value)
+			out_path = argv[++i];
+		else if (arg == "--list")
+			list_only = true;
+		else
+			ok = false;
+		if (!ok || config.min_time <= 0)
+		{
+			std::cerr << USAGE;
+			return 1;
+		}
+	}
+
+	std::vector<Carp::MicroBenchmark> benchmarks;
+	AddMoveBenchmarks(benchmarks);
+	AddEvalBenchmarks(benchmarks);
+	AddTTBenchmarks(benchmarks, threads);
+	AddControllerBenchmarks(benchmarks);
+
+	if (list_only)
+	{
+		for (const auto& bench : benchmarks)
+			std::cout << bench.name << '\n';
+		return 0;
+	}
+
+	// 进度写到stderr，stdout只留JSON
+	const auto results = Carp::RunMicroBenchmarks(benchmarks, config, std::cerr);
+	if (out_path.empty())
+	{
+		Carp::WriteMicroBenchJson(std::cout, results, config);
+		return 0;
+	}
+	std::ofstream out(out_path);
+	if (!out)
+	{
+		std::cerr << "cannot open " << out_path << "\n";
+		return 1;
+	}
+	Carp::WriteMicroBenchJson(out, results, config);
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include <charconv>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "core/perft.h"
+#include "core/position.h"
+
+int main(int argc, char** argv)
+{
+	int depth = 0;
+	if (argc >= 2)
+	{
+		const std::string_view arg = argv[1];
+		std::from_chars(arg.data(), arg.data() + arg.size(), depth);
+	}
+	if (depth < 1)
+	{
+		std::cerr << "usage: carp-perft <depth> [fen]\n";
+		return 1;
+	}
+
+	// FEN里有空格，后面的参数都拼起来
+	std::string fen;
+	for (int i = 2; i < argc; i++)
+	{
+		if (!fen.empty())
+			fen += ' ';
+		fen += argv[i];
+	}
+	Carp::Position pos;
+	if (!fen.empty() && !pos.SetFen(fen))
+	{
+		std::cerr << "invalid fen: " << fen << "\n";
+		return 1;
+	}
+	std::cout << Carp::PerftReport(pos, depth) << std::endl;
+	return 0;
+}